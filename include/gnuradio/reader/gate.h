@@ -10,6 +10,7 @@
 
 #include <gnuradio/block.h>
 #include <gnuradio/reader/api.h>
+#include <gnuradio/reader/global_vars.h>
 
 namespace gr {
 namespace reader {
@@ -31,8 +32,13 @@ public:
      * constructor is in a private implementation
      * class. reader::gate::make is the public interface for
      * creating new instances.
+     *
+     * \param reader_state 与同组 reader/tag_decoder 共享的上下文
+     * \param sample_rate 输入采样率（Hz）
+     * \param decimation  前端多相抽取因子；门控与解码都运行在 sample_rate/decimation，
+     *                    tag_decoder 的 sample_rate 应按抽取后的速率设置
      */
-    static sptr make(float sample_rate);
+    static sptr make(READER_STATE::sptr reader_state, float sample_rate, int decimation = 1);
 };
 
 } // namespace reader
@@ -9,8 +9,17 @@
 #define INCLUDED_READER_GLOBAL_VARS_H
 
 #include <gnuradio/reader/api.h>
+#include <gnuradio/reader/tag_table.h>
+#include <gnuradio/reader/latency_stats.h>
+#include <gnuradio/gr_complex.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
 #include <vector>
-#include <map>
+#include <memory>
 #include <sys/time.h>
 #include <math.h>
 #include <gnuradio/logger.h>
@@ -21,40 +30,219 @@ namespace reader {
     enum GEN2_LOGIC_STATUS {SEND_QUERY, SEND_ACK, SEND_QUERY_REP, IDLE, SEND_CW, SEND_EXTRA_CW, START, SEND_QUERY_ADJUST, SEND_NAK_QR, SEND_NAK_Q, POWER_DOWN};
     enum GATE_STATUS {GATE_OPEN, GATE_CLOSED, GATE_SEEK_RN16, GATE_SEEK_EPC, GATE_Handle};
     enum DECODER_STATUS {DECODER_DECODE_RN16, DECODER_DECODE_EPC};
+    enum DECODER_MODE {DECODER_MODE_HARD, DECODER_MODE_VITERBI}; // FM0 判决方式：逐比特硬判决 / 两状态网格软判决
+    enum ANTI_COLLISION {AC_FIXED_Q, AC_Q_ALGORITHM, AC_DFSA_SCHOUTE}; // 防碰撞策略：固定 Q / Annex D Q 算法 / DFSA + Schoute 估计
+    enum LINK_PROFILE {LINK_BLF40_FM0, LINK_BLF160_FM0, LINK_BLF320_FM0, LINK_BLF640_FM0,
+                       LINK_BLF160_M2, LINK_BLF256_M4, LINK_BLF320_M8}; // 具名链路参数（见 link_params()）
+
+    // 前导码比特数
+    const int TAG_PREAMBLE_BITS    = 6;   // FM0 前导码比特数（1010v1）
+    const int MILLER_PREAMBLE_BITS = 10;  // Miller 前导码比特数（4 个 pilot 0 + 010111）
+    const int TREXT_PILOT_BITS     = 12;  // TRext = 1 时前导码之前多出的 pilot 比特（FM0 12 个，Miller 16 - 4 个）
+
+    /*!
+     * \brief 一组 Gen2 链路参数（时长单位均为 us）。
+     *
+     * reader 按它生成 PIE 命令与 Query 中的 DR/M/TRext，gate/tag_decoder 按它换算
+     * 窗口长度与 tag 比特周期。PIE 的 data-1 = 2 Tari，RTcal = data-0 + data-1 = 3 Tari，
+     * PW = Tari / 2。
+     */
+    struct LINK_PARAMS
+    {
+        LINK_PROFILE profile;  // 参数来源（用于判断是否发生了切换）
+        float tari_d;          // Tari（data-0 长度）
+        float trcal_d;         // TRcal
+        int   dr;              // Query 的 DR 位：0 -> DR = 8，1 -> DR = 64/3
+        int   m;               // Query 的 M 字段：0 = FM0，1/2/3 = Miller 2/4/8
+        int   trext;           // Query 的 TRext 位：1 时标签先发 pilot tone
+        float t1_d;            // 命令结束到 gate 开门（略早于标称 T1 = max(RTcal, 10 Tpri)）
+        float t2_d;            // 回复结束到下一条命令（<= 20 Tpri）
+
+        float pw_d()    const { return tari_d / 2; }
+        float rtcal_d() const { return 3 * tari_d; }
+        float blf()     const { return (dr ? 64.0f / 3 : 8.0f) / trcal_d * 1e6f; }  // Hz
+        float tag_bit_d() const { return (1 << m) / blf() * 1e6f; }                 // 每个数据比特的时长
+        int preamble_bits() const { return m ? MILLER_PREAMBLE_BITS : TAG_PREAMBLE_BITS; } // 参与前导码相关的比特数
+        int pilot_bits()    const { return trext ? TREXT_PILOT_BITS : 0; }                 // 相关部分之前的 pilot 比特数
+    };
+
+    // 具名链路参数；profile 不在 LINK_PROFILE 范围内时抛出 std::invalid_argument
+    READER_API LINK_PARAMS link_params(LINK_PROFILE profile);
 
     // 运行统计信息（run-time statistics）：不参与信号处理，只用于记录盘存过程与结果
     struct READER_STATS 
     {    
-        int n_queries_sent;          // 已发送的 Query 类命令次数（Query / QueryRep / QueryAdjust 等，具体看实现里累加位置）
+        std::atomic<int> n_queries_sent; // 已发送的 Query 类命令次数（reader 累加，decoder 读取判断终止条件）
         int cur_inventory_round;     // 当前盘存轮次（inventory round）编号
         int cur_slot_number;         // 当前轮次内 slot 编号（0,1,2,...）
-        int max_slot_number;         // 一轮的最大 slot 数，通常为 2^Q（代码里常由 FIXED_Q 决定）
+        int max_slot_number;         // 当前轮次的 slot 数 2^Q（由防碰撞策略决定）
         int max_inventory_round;     // 最大盘存轮次（达到后可终止）
         int n_epc_correct;           // CRC 校验通过的 EPC 次数（成功解码次数）
+        int n_slots_empty;           // RN16 slot 分类：没有回复
+        int n_slots_single;          // RN16 slot 分类：单个标签（随后发 ACK）
+        int n_slots_collision;       // RN16 slot 分类：碰撞（不发 ACK）
         std::vector<int> unique_tags_round; // 每轮盘存读到的“唯一标签数”（每轮结束 push_back 一次计数）
-        std::map<int,int> tag_reads;         // 标签读数统计：tag_id -> 成功读到次数（tag_id 在实现里从 EPC 某些 bit 抽取）
+        tag_table tag_reads;                 // 唯一标签表：完整 EPC -> 读取次数/首末读取时间/RSSI（只由 decoder 写入）
         struct timeval start, end;   // 运行起止时间（用于耗时/吞吐统计）
     };
 
-    // 全局共享状态（global state）：三块 reader/gate/tag_decoder 通过它协同
-    struct READER_STATE
+    /*
+     * Gate -> Decoder 的回复窗口以突发（burst）的形式在样点流中传递，边界与描述符都是 stream tag：
+     * 窗口第一个样点上带 BURST_SOB_KEY 与 BURST_DC_KEY，最后一个样点上带 BURST_EOB_KEY（含关门时刻）。
+     * 描述符按字段打包在 uint64 向量里（每个窗口只有少数几个标签值），下标见 BURST_SOB_FIELD / BURST_EOB_FIELD。
+     * decoder 每次调用只消费一个完整突发，窗口的描述完全由标签给出，不经过共享状态。
+     * SOB 的同步字段由 gate 在前导码检测之后、关门之前原地写入，decoder 要等 EOB 到达后才能读取。
+     */
+    const char* const BURST_SOB_KEY        = "rx_sob";       // u64vector：BURST_SOB_FIELD
+    const char* const BURST_DC_KEY         = "dc_est";       // c32vector（1 个元素）：开门时减去的 DC 估计
+    const char* const BURST_EOB_KEY        = "rx_eob";       // u64vector：BURST_EOB_FIELD
+
+    enum BURST_SOB_FIELD
+    {
+        SOB_SEQ,          // 窗口序号（gate 开门计数）
+        SOB_TYPE,         // DECODER_STATUS（解 RN16 / EPC）
+        SOB_LINK,         // LINK_PROFILE
+        SOB_RX_SAMPLE,    // 窗口起点在 gate 输入上的（抽取后）样点序号
+        SOB_SYNC,         // 1：gate 已在窗口开头搜索过前导码，以下字段有效；0：decoder 自己搜索
+        SOB_SYNC_START,   // 前导码起点（samples，相对窗口起点），以下均为 float_field()
+        SOB_SYNC_T,       // 比特周期（samples/bit）
+        SOB_SYNC_QUALITY, // 归一化相关质量
+        SOB_SYNC_H_RE,    // 信道估计
+        SOB_SYNC_H_IM,
+        N_SOB_FIELDS
+    };
+
+    // 描述符里的 float 字段按位存放在 uint64 的低 32 位
+    inline uint64_t float_field(float v)
+    {
+        uint32_t u;
+        std::memcpy(&u, &v, sizeof(u));
+        return u;
+    }
+    inline float field_float(uint64_t f)
+    {
+        uint32_t u = (uint32_t) f;
+        float v;
+        std::memcpy(&v, &u, sizeof(v));
+        return v;
+    }
+    enum BURST_EOB_FIELD
+    {
+        EOB_LENGTH,     // 窗口长度（samples）
+        EOB_CLOSE_NS,   // 关门时的墙钟（wall_clock_ns()）
+        N_EOB_FIELDS
+    };
+
+    // 由突发标签解析出的一次回复窗口（RN16 或 EPC）
+    struct GATE_WINDOW
+    {
+        uint64_t           seq;                  // 窗口序号，decoder 据此发现被丢弃的窗口
+        DECODER_STATUS     type;                 // 窗口类型：解 RN16 还是解 EPC
+        LINK_PARAMS        link;                 // 开窗时的链路参数（决定 tag 比特周期）
+        gr_complex         dc_est;               // 开门时的 DC 估计（窗口内样点已减去）
+        uint64_t           rx_sample;            // 窗口起点的 RX 样点序号（gate 抽取后的采样率）
+        int                n_samples;            // 本窗口实际放行的样点数（没有回复或回复结束时 gate 提前关门）
+        uint64_t           close_ns;             // gate 关门时的墙钟（ns）
+        bool               synced;               // gate 已搜索过前导码，decoder 直接用下面的结果
+        float              sync_start;           // 前导码起点（samples，相对窗口起点）
+        float              sync_T;               // 估计的 tag 比特周期（samples/bit）
+        float              sync_quality;         // 归一化相关质量
+        gr_complex         sync_h;               // 信道估计
+    };
+
+    /*!
+     * \brief 定长比特序列，按 MSB-first 打包：第 i 个比特位于 data()[i / 8] 的第 (7 - i % 8) 位。
+     *
+     * 与 CRC 的输入格式一致，可直接交给 crc16()/crc5()；容量 N 在编译期确定，不做堆分配。
+     */
+    template <unsigned N>
+    class packed_bits
     {
-        STATUS            status;            // 系统运行状态：RUNNING / TERMINATED（用于停止条件）
-        GEN2_LOGIC_STATUS gen2_logic_status; // Reader 的 Gen2 逻辑状态机：下一步发什么（SEND_QUERY/SEND_ACK/...）
-        GATE_STATUS       gate_status;       // Gate 门控状态：开门/关门/搜 RN16/搜 EPC（GATE_OPEN/...）
-        DECODER_STATUS    decoder_status;    // Decoder 模式：解 RN16 还是解 EPC（DECODE_RN16/DECODE_EPC）
+    public:
+        packed_bits() { clear(); }
+
+        void clear() { d_bytes.fill(0); d_size = 0; }
+        void push_back(int bit)
+        {
+            if (d_size >= N) return;
+            if (bit) d_bytes[d_size / 8] |= 0x80 >> (d_size % 8);
+            d_size++;
+        }
+        template <typename T>
+        void append(const T* bits, unsigned n) { for (unsigned i = 0; i < n; i++) push_back(bits[i] != 0); }
+        template <unsigned M>
+        void append(const packed_bits<M>& bits) { for (unsigned i = 0; i < bits.size(); i++) push_back(bits[i]); }
+
+        int operator[](unsigned i) const { return (d_bytes[i / 8] >> (7 - i % 8)) & 1; }
+        // 把 [pos, pos + len) 当作 MSB-first 的无符号整数取出（len <= 32）
+        uint32_t field(unsigned pos, unsigned len) const
+        {
+            uint32_t v = 0;
+            for (unsigned i = 0; i < len; i++) v = (v << 1) | (*this)[pos + i];
+            return v;
+        }
+
+        unsigned size() const { return d_size; }
+        const uint8_t* data() const { return d_bytes.data(); }
+
+    private:
+        std::array<uint8_t, (N + 7) / 8> d_bytes;
+        unsigned d_size;
+    };
+
+    // 共享状态（per-flowgraph context）：一组 reader/gate/tag_decoder 通过它协同，
+    // 在 make() 时传入同一个实例；同一进程内的多组 reader 互不影响
+    struct READER_API READER_STATE
+    {
+        typedef std::shared_ptr<READER_STATE> sptr;
+
+        // 创建并初始化一个新的上下文；max_tags 为唯一标签表预分配的容量
+        static sptr make(int max_tags = TAG_TABLE_DEFAULT_SIZE);
+
+        // 三个 block 跑在不同的调度线程上：状态字段均为原子量，写入用 release、读取用 acquire，
+        // 保证看到新状态的一方也能看到写入方在此之前写下的数据（统计、RN16 等）
+        std::atomic<STATUS>            status;            // 系统运行状态：RUNNING / TERMINATED（用于停止条件）
+        std::atomic<GEN2_LOGIC_STATUS> gen2_logic_status; // Reader 的 Gen2 逻辑状态机：下一步发什么（SEND_QUERY/SEND_ACK/...）
+        std::atomic<GATE_STATUS>       gate_status;       // Gate 门控状态：reader 写入 SEEK_RN16/SEEK_EPC，gate 取走后改为 CLOSED/OPEN
 
         READER_STATS      reader_stats;      // 统计信息（由 reader/decoder 更新）
 
-        std::vector<float> magn_squared_samples; // Gate 在开门期间记录的 |x[n]|^2 序列（Decoder 用于同步/符号周期微调）
-        int n_samples_to_ungate;                 // 本次需要放行的样点数
+        packed_bits<16>   rn16;              // Decoder -> Reader：最近解出的 RN16，随 SEND_ACK 一起发布
+        int               q;                 // Decoder -> Reader：下一条 Query 使用的 Q，随 SEND_QUERY 一起发布
+        int               q_updn;            // Decoder -> Reader：下一条 QueryAdjust 的 UpDn（Q_UPDN 行号），随 SEND_QUERY_ADJUST 一起发布
+        LINK_PARAMS       link;              // Reader -> Gate：当前链路参数，随 GATE_SEEK_* 一起发布，只在 Query（新一轮）时切换
+        uint64_t          tx_command_start;  // Reader -> Gate：该命令第一个样点的 TX 序号，随 GATE_SEEK_* 一起发布
+        uint64_t          tx_command_end;    // Reader -> Gate：该命令最后一个 PIE 符号结束处的 TX 样点序号，随 GATE_SEEK_* 一起发布
+        double            tx_rate;           // Reader -> Gate：TX 样点速率（Hz），reader 构造时写入；0 表示没有时间线
+
+        // 转换延迟：decoder 随每个决定发布所属的转换（TURNAROUND，-1 为不计）与时间戳，
+        // 写完后递增 turnaround_seq（release）；reader 看到新的序号时记录自己那几段
+        int                   turnaround_path;
+        uint64_t              reply_close_ns;   // 该回复窗口 gate 关门的墙钟
+        uint64_t              decided_ns;       // decoder 发布决定的墙钟
+        std::atomic<uint64_t> turnaround_seq;
+        latency_stats         latency;          // 各交接点的延迟直方图（每个 block 只写自己记录的项）
+
+        // 写入新的逻辑状态并唤醒在 wait_gen2_logic_status() 中等待的 reader
+        void set_gen2_logic_status(GEN2_LOGIC_STATUS s);
+        // 阻塞直到逻辑状态不再是 s 或超时，返回当前状态
+        GEN2_LOGIC_STATUS wait_gen2_logic_status(GEN2_LOGIC_STATUS s, int timeout_ms);
+
+    private:
+        std::mutex              d_wake_mutex;
+        std::condition_variable d_wake_cond;
     };
 
     // 配置
 
-    // Fixed number of slots (2^(FIXED_Q))  
+    // Fixed number of slots (2^(FIXED_Q))，用于 AC_FIXED_Q 策略
     const int FIXED_Q       = 0;
 
+    // 动态 Q 的初始值与上限；Q 算法每个空/碰撞 slot 令 Qfp 变化 C（Annex D 建议 0.1 < C < 0.5）
+    const int INITIAL_Q       = 4;
+    const int MAX_Q           = 15;
+    const float Q_ALGORITHM_C = 0.3;
+
     // const int MAX_INVENTORY_ROUND = 50;
     const int MAX_NUM_QUERIES     = 1000;     // Stop after MAX_NUM_QUERIES have been sent 
 
@@ -71,14 +259,11 @@ namespace reader {
 
     // Duration in us（单位：微秒 us）
     // reader ---> tag
+    // Tari/TRcal/T1/T2 等随链路参数变化，见 LINK_PARAMS
     const int CW_D         = 250;    // Carrier wave
     const int P_DOWN_D     = 2000;    // power down
-    const int T1_D         = 240;    // Time from Interrogator transmission to Tag response (250 us)
-    const int T2_D         = 480;    // Time from Tag response to Interrogator transmission. Max value = 20.0 * T_tag = 500us 
-    const int PW_D         = 12;      // Half Tari 
     const int DELIM_D       = 12;      // A preamble shall comprise a fixed-length start delimiter 12.5us +/-5%
-    const int TRCAL_D     = 200;    // BLF = DR/TRCAL => 40e3 = 8/TRCAL => TRCAL = 200us
-    const int RTCAL_D     = 72;      // 6*PW = 72us
+    const int CW_CHUNK_D  = 50;      // 命令之后的 CW 按这个粒度输出，decoder 提前判决后剩余部分被截断
 
     /*
      * GATE 参数
@@ -87,31 +272,34 @@ namespace reader {
     const int NUMBER_UNIQUE_TAGS = 100;     // Stop after NUMBER_UNIQUE_TAGS have been read
     const float THRESH_FRACTION = 0.75;     
     const int WIN_SIZE_D         = 250;
+    const int GATE_CHUNK_SIZE    = 8192;    // 包络/门限按块计算的块长（samples）
+
+    // TX/RX 时间线：连续 TIMELINE_CAL_COMMANDS 次包络检测得到的收发延迟相差不超过 TIMELINE_CAL_TOL_D（us）
+    // 即锁定，之后按命令结束的 TX 样点序号开门；锁定后连续 TIMELINE_MISS_LIMIT 次在预期位置
+    // 看不到命令末尾的 PIE 低电平时退回包络检测
+    const int TIMELINE_CAL_COMMANDS = 3;
+    const float TIMELINE_CAL_TOL_D  = 1.0;
+    const int TIMELINE_MISS_LIMIT   = 3;
+    const uint64_t TX_TIME_UNKNOWN  = UINT64_MAX;   // reader 尚未发布命令结束时间
+
+    // Reader 在 IDLE 时阻塞等待 decoder 决定的最长时间（ms），超时后返回调度器以便响应 stop()
+    const int IDLE_WAIT_MS       = 50;
 
     // 命令比特数
-    const int PILOT_TONE          = 12;  // Optional
-    const int TAG_PREAMBLE_BITS   = 6;   // Number of preamble bits
     const int RN16_BITS           = 17;  // Dummy bit at the end
     const int EPC_BITS            = 129;  // PC + EPC + CRC16 + Dummy = 6 + 16 + 96 + 16 + 1 = 135
     const int QUERY_LENGTH        = 22;  // Query length in bits
+    const int ACK_LENGTH          = 18;  // ACK length in bits (2 + RN16)
+    const int QUERY_ADJUST_LENGTH = 9;   // QueryAdjust length in bits
     
-    // 下行链路长度估计
-    // tag ---> reader
-    const int T_READER_FREQ       = 40e3;     // BLF = 40kHz
-    const float TAG_BIT_D         = 1.0/T_READER_FREQ * pow(10,6); // Duration in us
-    const int RN16_D              = (RN16_BITS + TAG_PREAMBLE_BITS) * TAG_BIT_D;
-    const int EPC_D               = (EPC_BITS  + TAG_PREAMBLE_BITS) * TAG_BIT_D;
-
     // 命令内容
 
     // Query command 
+    // DR、M、TRext 取自当前的 LINK_PARAMS
     const int QUERY_CODE[4] = {1,0,0,0};
-    const int M[2]          = {0,0};
     const int SEL[2]         = {0,0};
     const int SESSION[2]     = {0,0};
     const int TARGET         = 0;
-    const int TREXT         = 0;
-    const int DR            = 0;
 
     // NAK command
     const int NAK_CODE[8]   = {1,1,0,0,0,0,0,0};
@@ -127,13 +315,49 @@ namespace reader {
     // FM0 encoding preamble sequences
     const int TAG_PREAMBLE[] = {1,1,0,1,0,0,1,0,0,0,1,1};
 
+    // 前导码起点的搜索范围（tag bits），覆盖 T1 的抖动
+    const float PREAMBLE_SEARCH_BITS = 3.0;
+
+    // 前导码检测门限：sync quality * 前导码样点数。纯噪声时近似 Exp(1) 的最大值（约 10），
+    // 低于门限判为空 slot
+    const float PREAMBLE_DETECT_THRESHOLD = 24;
+    // RN16 碰撞判决：重调制残差中的干扰能量超过信号能量的 COLLISION_ISR，
+    // 且残差超过噪声底的 COLLISION_NOISE_RATIO 倍
+    const float COLLISION_ISR         = 0.1;
+    const float COLLISION_NOISE_RATIO = 1.5;
+    // 回复结束：检测到前导码后，窗口最多放行到 前导码起点 + (前导码 + 数据) 比特 * (1 + REPLY_T_TOLERANCE)
+    // 再加 REPLY_TAIL_BITS 比特（周期由前导码估计，不再按 BLF_TOLERANCE 放宽）；
+    // 其间若最近 EOB_BITS 个比特内 |x|^2 的均值低于 T1 期间噪声功率的 EOB_NOISE_RATIO 倍，认为所有回波都已结束，立即关门。
+    // 标签在两个反射状态之间切换，去掉 DC（空闲状态）后 FM0 的比特 1 可能整比特为 0，但相邻两个比特中至少有一个不是；
+    // 按噪声底而不是前导码幅度判断：碰撞时各标签的数据互相抵消，能量可能远低于前导码但回波仍在继续。
+    // 前导码功率不到门限的 EOB_MIN_SNR 倍时不做检测
+    const int   EOB_BITS              = 4;
+    const float REPLY_T_TOLERANCE     = 0.03;
+    const float REPLY_TAIL_BITS       = 1.0;
+    const float EOB_NOISE_RATIO       = 1.5;
+    const float EOB_MIN_SNR           = 2.0;
+
+    // Gen2 允许的 BLF 偏差（最大 ±22%），前导码搜索与窗口长度都按此放宽
+    const float BLF_TOLERANCE     = 0.22;
+
+    // gate 为 data_bits 个数据比特的回复放行的最长窗口（samples）：起点搜索、pilot、前导码与 1 bit 余量，
+    // 按最大 BLF 偏差放宽。gate 与 decoder 都按 EPC 的窗口预留缓冲
+    inline int reply_window_samples(const LINK_PARAMS& link, int data_bits, float samples_per_bit)
+    {
+        float bits = data_bits + PREAMBLE_SEARCH_BITS + link.pilot_bits() + link.preamble_bits() + 1;
+        return bits * samples_per_bit * (1 + BLF_TOLERANCE);
+    }
+    // 所有具名链路参数中最长的 EPC 回复窗口（samples，sample_rate 为 gate 的输出速率）。
+    // 链路参数可以在运行中切换，gate 按它预留输出缓冲
+    READER_API int max_reply_window_samples(float sample_rate);
+    // FM0 比特边界 early-late 定时环路增益（每比特）
+    const float EL_GAIN_TIMING    = 0.3;   // 起点修正
+    const float EL_GAIN_PERIOD    = 0.02;  // 周期修正
+
     
-    // Duration in which dc offset is estimated (T1_D is 250)
+    // Duration in which dc offset is estimated（不超过 T1 的一半，避免混入命令的 PIE 脉冲）
     const int DC_SIZE_D         = 120;
 
-    // Global variable
-    extern READER_STATE * reader_state;
-    extern READER_API void initialize_reader_state();
 } // namespace reader
 } // namespace gr
 
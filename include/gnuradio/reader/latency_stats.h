@@ -0,0 +1,119 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 mzssbqd.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_LATENCY_STATS_H
+#define INCLUDED_READER_LATENCY_STATS_H
+
+#include <gnuradio/reader/api.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace gr {
+namespace reader {
+
+    // 一次标签回复之后的收发转换（turnaround）：RN16 -> ACK 必须在 T2（<= 20 Tpri）内完成，
+    // EPC -> 下一个 slot 的命令（QueryRep / QueryAdjust / Query / NAK）
+    enum TURNAROUND {TURNAROUND_RN16_ACK, TURNAROUND_EPC_NEXT};
+    const int N_TURNAROUNDS = 2;
+
+    // 转换途中的各个交接点：gate 关门 -> decoder 发布决定 -> reader 生成命令 -> 第一个命令样点交给输出缓冲
+    enum LATENCY_STAGE
+    {
+        LAT_GATE_TO_DECODER,    // 墙钟：gate 关门 -> decoder 解完并发布下一步（调度唤醒 + 解码），decoder 记录
+        LAT_DECODER_TO_RENDER,  // 墙钟：decoder 发布 -> reader 生成命令（reader 唤醒 + 命令生成），reader 记录
+        LAT_RENDER_TO_EMIT,     // 墙钟：命令生成 -> 第一个命令样点写入输出缓冲，reader 记录
+        LAT_TOTAL,              // 墙钟：gate 关门 -> 第一个命令样点写入输出缓冲，reader 记录
+        LAT_AIR,                // 样点时间：回复窗口结束 -> 下一条命令在 RX 上开始（含 TX/RX 缓冲深度），gate 记录
+    };
+    const int N_LATENCY_STAGES = 5;
+
+    // 单调墙钟（ns），各 block 的时间戳都取自这里
+    inline uint64_t wall_clock_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 一个直方图的摘要（us）
+    struct LATENCY_SUMMARY
+    {
+        uint64_t count;
+        double p50_us;
+        double p99_us;
+        double max_us;
+    };
+
+    /*!
+     * \brief 对数分桶的延迟直方图（ns）。
+     *
+     * 16 ns 以下每 ns 一个桶，之上每个 2 的幂区间分 8 个桶（相对分辨率 1/8，1 us 附近为 64 ns），
+     * 覆盖到约 2^40 ns，更长的计入最后一个桶。桶计数为原子量：每个直方图只有一个写者，
+     * record() 不加锁、不分配；其它线程可以在运行中读取（各桶之间不保证同一时刻的快照）。
+     */
+    class READER_API latency_histogram
+    {
+    public:
+        static constexpr int LINEAR_BUCKETS = 16;
+        static constexpr int SUB_BITS       = 3;
+        static constexpr int MAX_EXPONENT   = 40;
+        static constexpr int N_BUCKETS      = LINEAR_BUCKETS + (MAX_EXPONENT - 4) * (1 << SUB_BITS);
+
+        latency_histogram() { clear(); }
+
+        void record(uint64_t ns)
+        {
+            d_buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+            if (ns > d_max.load(std::memory_order_relaxed))
+                d_max.store(ns, std::memory_order_relaxed);
+        }
+        void clear();
+
+        uint64_t count() const;
+        double percentile(double p) const;    // us，取所在桶的中点（不超过最大值）
+        double max() const { return d_max.load(std::memory_order_relaxed) / 1e3; } // us
+
+    private:
+        std::array<std::atomic<uint32_t>, N_BUCKETS> d_buckets;
+        std::atomic<uint64_t> d_max;
+
+        static int bucket(uint64_t ns)
+        {
+            if (ns < LINEAR_BUCKETS)
+                return (int) ns;
+            int e = 63 - __builtin_clzll(ns);   // ns >= 16 时 e >= 4
+            if (e >= MAX_EXPONENT)
+                return N_BUCKETS - 1;
+            return LINEAR_BUCKETS + (e - 4) * (1 << SUB_BITS) + (int) ((ns >> (e - SUB_BITS)) & ((1 << SUB_BITS) - 1));
+        }
+        static double bucket_mid(int b);   // 桶中点（ns）
+    };
+
+    /*!
+     * \brief 每种转换、每个交接点各一个直方图。
+     *
+     * 同组 reader/gate/tag_decoder 共用一份（READER_STATE::latency），每个 block 只写自己记录的那几项
+     * （见 LATENCY_STAGE），因此写入都是单写者、无锁的。
+     */
+    class READER_API latency_stats
+    {
+    public:
+        latency_histogram& at(TURNAROUND path, LATENCY_STAGE stage) { return d_hist[path][stage]; }
+        const latency_histogram& at(TURNAROUND path, LATENCY_STAGE stage) const { return d_hist[path][stage]; }
+
+        LATENCY_SUMMARY summary(TURNAROUND path, LATENCY_STAGE stage) const;
+        void clear();
+
+    private:
+        std::array<std::array<latency_histogram, N_LATENCY_STAGES>, N_TURNAROUNDS> d_hist;
+    };
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_LATENCY_STATS_H */
@@ -10,6 +10,7 @@
 
 #include <gnuradio/block.h>
 #include <gnuradio/reader/api.h>
+#include <gnuradio/reader/global_vars.h>
 #include <vector>
 
 namespace gr {
@@ -31,9 +32,31 @@ public:
      * constructor is in a private implementation
      * class. reader::reader::make is the public interface for
      * creating new instances.
+     *
+     * \param num_sines    额外载波路数，取 freqs/amps 的前 num_sines 项
+     * \param link_profile 初始的链路参数（Tari、BLF、DR、Miller M、TRext），见 link_params()
      */
-    static sptr make(float sample_rate, float dac_rate, int num_sines, std::vector<float> freqs, std::vector<float> amps);
+    static sptr make(READER_STATE::sptr reader_state, float sample_rate, float dac_rate, int num_sines, std::vector<float> freqs, std::vector<float> amps,
+                     LINK_PROFILE link_profile = LINK_BLF40_FM0);
     virtual void print_results() = 0;
+
+    //! 运行时切换链路参数，从下一条 Query（新一轮盘存）开始生效；gate/tag_decoder 随之切换
+    virtual void set_link_profile(LINK_PROFILE link_profile) = 0;
+    virtual LINK_PROFILE link_profile() const = 0;
+
+    /*!
+     * 运行时改变 ACK 之后的额外载波（频率 Hz、线性幅度，两者等长；为空则发普通 CW），
+     * 从下一次 work 调用开始生效，已有各路保持相位连续。
+     * 也可以向 "tones" 消息端口发送字典 {freqs: [...], amps: [...]}。
+     */
+    virtual void set_tones(const std::vector<float>& freqs, const std::vector<float>& amps) = 0;
+
+    /*!
+     * 回复之后的收发转换延迟（us）：gate 关门、decoder 发布决定、reader 生成命令、
+     * 第一个命令样点交出各交接点之间的墙钟延迟，以及回复结束到下一条命令开始的空口间隔（样点时间）。
+     * 运行中也可以调用。
+     */
+    virtual LATENCY_SUMMARY turnaround_latency(TURNAROUND path, LATENCY_STAGE stage) const = 0;
 };
 
 } // namespace reader
@@ -31,8 +31,22 @@ public:
      * constructor is in a private implementation
      * class. reader::tag_decoder::make is the public interface for
      * creating new instances.
+     *
+     * \param reader_state 与同组 reader/gate 共享的上下文
+     * \param sample_rate  输入采样率（Hz）
+     * \param decoder_mode FM0 判决方式：DECODER_MODE_HARD 逐比特硬判决，
+     *                     DECODER_MODE_VITERBI 在两状态网格上做 max-log 软判决（Miller 回复始终硬判决）
+     * \param anti_collision_policy 防碰撞策略：AC_FIXED_Q 每轮固定 2^Q 个 slot，
+     *                     AC_Q_ALGORITHM 为 Gen2 Annex D 的 Q 算法（按空/碰撞 slot 发 QueryAdjust），
+     *                     AC_DFSA_SCHOUTE 在每帧结束时按 Schoute 估计的标签数重选 Q
+     * \param initial_q    第一轮的 Q（0..15）；AC_FIXED_Q 下即为固定的 Q
      */
-    static sptr make(float sample_rate);
+    static sptr make(READER_STATE::sptr reader_state, float sample_rate, DECODER_MODE decoder_mode = DECODER_MODE_HARD,
+                     ANTI_COLLISION anti_collision_policy = AC_Q_ALGORITHM, int initial_q = INITIAL_Q);
+
+    //! 运行时切换 FM0 判决方式，从下一个回复窗口开始生效
+    virtual void set_decoder_mode(DECODER_MODE decoder_mode) = 0;
+    virtual DECODER_MODE decoder_mode() const = 0;
 };
 
 } // namespace reader
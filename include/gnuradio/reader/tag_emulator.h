@@ -0,0 +1,77 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_TAG_EMULATOR_H
+#define INCLUDED_READER_TAG_EMULATOR_H
+
+#include <gnuradio/sync_block.h>
+#include <gnuradio/reader/api.h>
+#include <gnuradio/reader/global_vars.h>
+
+namespace gr {
+namespace reader {
+
+/*!
+ * \brief 软件标签群仿真：把 reader 的 TX 波形变成 gate 需要的复基带接收流。
+ * \ingroup reader
+ *
+ * 输入为 reader block 输出的载波幅度（float），输出为同速率的复基带（gr_complex）。
+ * 按 PIE 解出 Query/QueryRep/QueryAdjust/ACK/NAK，驱动一组虚拟标签的 Gen2 状态机
+ * （各自的 slot 计数器、RN16、EPC 与 inventoried 标志），并把它们的 FM0 / Miller 回波（M 与 TRext 取自 Query）合成到
+ * 接收流中：
+ *
+ *   y[n] = x[n] * (dc_offset + amplitude * e^{j phase} * sum_i s_i[n]) + w[n]
+ *
+ * 其中 s_i 为第 i 个标签的回波码片电平（±1，不回复时为 0），w 为复高斯噪声。
+ * 不依赖硬件，也不限速，可以让整个 flowgraph 以快于实时的速度运行。
+ */
+class READER_API tag_emulator : virtual public gr::sync_block
+{
+public:
+    typedef std::shared_ptr<tag_emulator> sptr;
+
+    /*!
+     * \brief Return a shared_ptr to a new instance of reader::tag_emulator.
+     *
+     * To avoid accidental use of raw pointers, reader::tag_emulator's
+     * constructor is in a private implementation
+     * class. reader::tag_emulator::make is the public interface for
+     * creating new instances.
+     *
+     * \param sample_rate  采样率（Hz），与 reader 的输出速率一致
+     * \param n_tags       虚拟标签数，每个标签有随机的 96-bit EPC
+     * \param blf_error    标签 BLF 相对 reader 指定值（DR/TRcal）的偏差，例如 0.1 表示快 10%
+     * \param snr_db       每样点 SNR：回波幅度平方 / 噪声功率（dB）
+     * \param amplitude    回波幅度（相对载波幅度 1）
+     * \param phase        回波相位（rad）
+     * \param dc_offset    载波泄漏（复数），即接收端的直流分量
+     * \param t1_jitter_us 回复起点 T1 的均匀抖动范围 ±t1_jitter_us（us）
+     * \param seed         随机数种子（EPC、RN16、slot、噪声）
+     */
+    static sptr make(float sample_rate,
+                     int n_tags = 1,
+                     float blf_error = 0,
+                     float snr_db = 20,
+                     float amplitude = 0.05,
+                     float phase = 0,
+                     gr_complex dc_offset = gr_complex(0.6, 0.2),
+                     float t1_jitter_us = 0,
+                     int seed = 0);
+
+    //! 运行时修改 SNR（dB）
+    virtual void set_snr_db(float snr_db) = 0;
+
+    //! 已发出的回复数（RN16 + EPC）
+    virtual int n_replies() const = 0;
+    //! 本次上电以来被正确 ACK 过的标签数（载波中断超过 1 ms 视为掉电，标签状态全部复位）
+    virtual int n_inventoried() const = 0;
+};
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_TAG_EMULATOR_H */
@@ -0,0 +1,79 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 mzssbqd.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_TAG_TABLE_H
+#define INCLUDED_READER_TAG_TABLE_H
+
+#include <gnuradio/reader/api.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/time.h>
+
+namespace gr {
+namespace reader {
+
+    const int TAG_EPC_BYTES          = 12;    // 标签表的键：96-bit EPC
+    const int TAG_TABLE_DEFAULT_SIZE = 4096;  // 默认可容纳的唯一标签数
+
+    // 一个唯一标签的读取记录
+    struct TAG_ENTRY
+    {
+        std::array<uint8_t, TAG_EPC_BYTES> epc; // EPC（MSB-first）
+        uint32_t       n_reads;                 // 成功读取次数；0 表示空槽
+        float          last_rssi;               // 最近一次读取的回波强度（dBFS，由信道估计 |h|^2 换算）
+        struct timeval first_seen, last_seen;   // 首次/最近一次读取时间
+    };
+
+    /*!
+     * \brief 以完整 EPC 为键的唯一标签表（开放寻址 + 线性探测）。
+     *
+     * 槽位数组在构造/reset() 时按容量一次性分配（槽数为容量的 2 倍向上取 2 的幂，
+     * 负载因子不超过 1/2），之后 record()/find() 都是常数时间、不做任何分配。
+     * 表满后新出现的标签不再插入，只计入 n_dropped()。
+     * 只由 tag_decoder 写入；其它 block 只在流图停止后读取（print_results）。
+     */
+    class READER_API tag_table
+    {
+    public:
+        explicit tag_table(size_t max_tags = TAG_TABLE_DEFAULT_SIZE);
+
+        // 清空并按新的容量重新分配
+        void reset(size_t max_tags);
+        void clear();
+
+        // 记录一次成功读取，返回对应条目；表满且为新标签时返回 nullptr
+        TAG_ENTRY* record(const uint8_t* epc, const struct timeval& now, float rssi);
+        const TAG_ENTRY* find(const uint8_t* epc) const;
+
+        size_t size() const { return d_size; }          // 唯一标签数
+        size_t capacity() const { return d_max_tags; }  // 可容纳的唯一标签数
+        size_t n_dropped() const { return d_dropped; }  // 因表满未能记录的读取次数
+
+        // 依次访问所有已记录的标签（顺序与插入顺序无关）
+        template <typename F>
+        void for_each(F f) const
+        {
+            for (const TAG_ENTRY& e : d_slots)
+                if (e.n_reads) f(e);
+        }
+
+    private:
+        std::vector<TAG_ENTRY> d_slots;
+        size_t d_mask;
+        size_t d_max_tags;
+        size_t d_size;
+        size_t d_dropped;
+
+        size_t probe(const uint8_t* epc) const; // 返回键所在槽或第一个空槽
+    };
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_TAG_TABLE_H */
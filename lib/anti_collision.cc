@@ -0,0 +1,92 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "anti_collision.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace gr {
+namespace reader {
+
+anti_collision::uptr anti_collision::make(ANTI_COLLISION policy, int initial_q)
+{
+    if (initial_q < 0 || initial_q > MAX_Q)
+        throw std::invalid_argument("anti_collision: initial Q must be in [0, 15]");
+
+    switch (policy)
+    {
+        case AC_FIXED_Q:      return uptr(new fixed_q(initial_q));
+        case AC_Q_ALGORITHM:  return uptr(new q_algorithm(initial_q));
+        case AC_DFSA_SCHOUTE: return uptr(new dfsa_schoute(initial_q));
+    }
+    throw std::invalid_argument("anti_collision: unknown policy");
+}
+
+SLOT_DECISION anti_collision::next_slot()
+{
+    if (d_slot >= (1 << d_q))
+        return new_round(d_q);
+
+    d_slot++;
+    return { SEND_QUERY_REP, d_q, 1, false };
+}
+
+SLOT_DECISION anti_collision::new_round(int q)
+{
+    d_q = q;
+    d_slot = 1;
+    return { SEND_QUERY, d_q, 1, true };
+}
+
+SLOT_DECISION anti_collision::adjust(int q)
+{
+    int updn = (q > d_q) ? 0 : 2;
+    d_q = q;
+    d_slot = 1;
+    return { SEND_QUERY_ADJUST, d_q, updn, true };
+}
+
+SLOT_DECISION fixed_q::slot_done(SLOT_OUTCOME outcome)
+{
+    return next_slot();
+}
+
+SLOT_DECISION q_algorithm::slot_done(SLOT_OUTCOME outcome)
+{
+    if (outcome == SLOT_EMPTY)
+        d_qfp = std::max(0.0f, d_qfp - Q_ALGORITHM_C);
+    else if (outcome == SLOT_COLLISION)
+        d_qfp = std::min((float) MAX_Q, d_qfp + Q_ALGORITHM_C);
+
+    // C < 1，round(Qfp) 每个 slot 至多变化 1，正好对应一次 QueryAdjust
+    int q = (int) std::lround(d_qfp);
+    if (q != d_q)
+        return adjust(q);
+    return next_slot();
+}
+
+SLOT_DECISION dfsa_schoute::slot_done(SLOT_OUTCOME outcome)
+{
+    if (outcome == SLOT_SINGLE)
+        d_single++;
+    else if (outcome == SLOT_COLLISION)
+        d_collision++;
+
+    if (d_slot < (1 << d_q))
+        return next_slot();
+
+    // 帧结束：Schoute 估计。成功的标签已退出本次盘存，剩下的都在碰撞 slot 里，
+    // 泊松假设下每个碰撞 slot 平均 2.39 个标签
+    float n_est = 2.39f * d_collision;
+    int q = (n_est < 1) ? 0 : (int) std::lround(std::log2(n_est));
+    d_single = d_collision = 0;
+    return new_round(std::max(0, std::min(MAX_Q, q)));
+}
+
+} // namespace reader
+} // namespace gr
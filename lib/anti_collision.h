@@ -0,0 +1,93 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_ANTI_COLLISION_H
+#define INCLUDED_READER_ANTI_COLLISION_H
+
+#include <gnuradio/reader/global_vars.h>
+#include <memory>
+
+namespace gr {
+namespace reader {
+
+// 一个 slot 的结果（由 tag_decoder 判定）
+enum SLOT_OUTCOME {SLOT_EMPTY, SLOT_SINGLE, SLOT_COLLISION};
+
+// 策略对一个 slot 结束后的决定
+struct SLOT_DECISION
+{
+    GEN2_LOGIC_STATUS next;   // 下一条命令：SEND_QUERY_REP / SEND_QUERY_ADJUST / SEND_QUERY
+    int q;                    // 下一条 Query/QueryAdjust 之后生效的 Q
+    int q_updn;               // QueryAdjust 的 UpDn：Q_UPDN 的行号（0 增，1 不变，2 减）
+    bool new_round;           // 是否开始新的盘存轮次（slot 计数重置）
+};
+
+/*!
+ * \brief 防碰撞策略接口。
+ *
+ * tag_decoder 在每个 slot 结束时调用 slot_done()，策略根据 slot 结果决定下一条命令和 Q。
+ * 轮次内的 slot 计数由基类维护：一轮 2^Q 个 slot 用完后发新的 Query。
+ */
+class anti_collision
+{
+public:
+    typedef std::unique_ptr<anti_collision> uptr;
+
+    static uptr make(ANTI_COLLISION policy, int initial_q);
+
+    virtual ~anti_collision() {}
+    virtual SLOT_DECISION slot_done(SLOT_OUTCOME outcome) = 0;
+
+    int q() const { return d_q; }
+
+protected:
+    anti_collision(int initial_q) : d_q(initial_q), d_slot(1) {}
+
+    int d_q;      // 当前轮次的 Q
+    int d_slot;   // 当前轮次内的 slot 序号（从 1 开始）
+
+    SLOT_DECISION next_slot();             // 本轮还有 slot 时 QueryRep，否则以当前 Q 开始新的一轮
+    SLOT_DECISION new_round(int q);        // 以新的 Q 发 Query 开始新的一轮
+    SLOT_DECISION adjust(int q);           // 发 QueryAdjust（Q 只能 ±1）开始新的一轮
+};
+
+// 固定 Q：每轮 2^Q 个 slot，Q 不变
+class fixed_q : public anti_collision
+{
+public:
+    fixed_q(int q) : anti_collision(q) {}
+    SLOT_DECISION slot_done(SLOT_OUTCOME outcome) override;
+};
+
+// ISO/IEC 18000-63 Annex D 的 Q 算法：空 slot 令 Qfp 减 C，碰撞令 Qfp 加 C，
+// round(Qfp) 变化时立即发 QueryAdjust
+class q_algorithm : public anti_collision
+{
+public:
+    q_algorithm(int q) : anti_collision(q), d_qfp(q) {}
+    SLOT_DECISION slot_done(SLOT_OUTCOME outcome) override;
+
+private:
+    float d_qfp;  // 浮点 Q
+};
+
+// 动态帧时隙 ALOHA + Schoute 估计：每帧结束时按 n = 2.39 c（c 为碰撞 slot 数）估计剩余标签数，
+// 下一帧取 2^Q 最接近 n
+class dfsa_schoute : public anti_collision
+{
+public:
+    dfsa_schoute(int q) : anti_collision(q), d_single(0), d_collision(0) {}
+    SLOT_DECISION slot_done(SLOT_OUTCOME outcome) override;
+
+private:
+    int d_single, d_collision;  // 本帧的成功/碰撞 slot 数
+};
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_ANTI_COLLISION_H */
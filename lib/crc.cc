@@ -0,0 +1,106 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "crc.h"
+#include <array>
+
+namespace gr {
+namespace reader {
+
+namespace {
+
+const uint16_t CRC16_POLY   = 0x1021;
+const uint16_t CRC16_PRESET = 0xFFFF;
+// CRC-5 的 5 位寄存器左对齐放在一个字节的高 5 位，便于按字节查表
+const uint8_t  CRC5_POLY    = 0x09 << 3;
+const uint8_t  CRC5_PRESET  = 0x09 << 3;
+
+typedef std::array<std::array<uint16_t, 256>, 4> crc16_tables;
+
+// tables[0][x]：寄存器高字节为 x、其余为 0 时移入一个字节后的寄存器；
+// tables[k][x]：同一字节再经过 k 个字节后的贡献
+constexpr crc16_tables make_crc16_tables()
+{
+    crc16_tables t{};
+    for (int x = 0; x < 256; x++)
+    {
+        uint16_t crc = x << 8;
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ CRC16_POLY) : (uint16_t)(crc << 1);
+        t[0][x] = crc;
+    }
+    for (int k = 1; k < 4; k++)
+        for (int x = 0; x < 256; x++)
+            t[k][x] = (uint16_t)(t[k - 1][x] << 8) ^ t[0][t[k - 1][x] >> 8];
+    return t;
+}
+
+constexpr std::array<uint8_t, 256> make_crc5_table()
+{
+    std::array<uint8_t, 256> t{};
+    for (int x = 0; x < 256; x++)
+    {
+        uint8_t crc = x;
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ CRC5_POLY) : (uint8_t)(crc << 1);
+        t[x] = crc;
+    }
+    return t;
+}
+
+constexpr crc16_tables CRC16_TABLES = make_crc16_tables();
+constexpr std::array<uint8_t, 256> CRC5_TABLE = make_crc5_table();
+
+} // namespace
+
+uint16_t crc16(const uint8_t* bytes, size_t n_bytes)
+{
+    const auto& t = CRC16_TABLES;
+    uint16_t crc = CRC16_PRESET;
+    size_t i = 0;
+
+    // slice-by-4：寄存器与前两个字节异或后，四个字节的贡献相互独立
+    for (; i + 4 <= n_bytes; i += 4)
+    {
+        uint16_t r = crc ^ (uint16_t)((bytes[i] << 8) | bytes[i + 1]);
+        crc = t[3][r >> 8] ^ t[2][r & 0xFF] ^ t[1][bytes[i + 2]] ^ t[0][bytes[i + 3]];
+    }
+    for (; i < n_bytes; i++)
+        crc = (uint16_t)(crc << 8) ^ t[0][(crc >> 8) ^ bytes[i]];
+
+    return ~crc;
+}
+
+bool crc16_check(const uint8_t* bytes, size_t n_bytes)
+{
+    if (n_bytes < 2)
+        return false;
+    uint16_t rcvd = (uint16_t)((bytes[n_bytes - 2] << 8) | bytes[n_bytes - 1]);
+    return crc16(bytes, n_bytes - 2) == rcvd;
+}
+
+uint8_t crc5(const uint8_t* bytes, size_t n_bits)
+{
+    uint8_t crc = CRC5_PRESET;
+    size_t n_bytes = n_bits / 8;
+    for (size_t i = 0; i < n_bytes; i++)
+        crc = CRC5_TABLE[crc ^ bytes[i]];
+
+    // 剩余不足一字节的比特逐位处理
+    for (size_t i = n_bytes * 8; i < n_bits; i++)
+    {
+        uint8_t bit = (bytes[i / 8] >> (7 - i % 8)) & 1;
+        uint8_t fb = (crc >> 7) ^ bit;
+        crc = (uint8_t)(crc << 1);
+        if (fb)
+            crc ^= CRC5_POLY;
+    }
+    return crc >> 3;
+}
+
+} // namespace reader
+} // namespace gr
@@ -0,0 +1,40 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_CRC_H
+#define INCLUDED_READER_CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace reader {
+
+/*
+ * Gen2 CRC（ISO/IEC 18000-63 Annex F），输入为按 MSB-first 打包的比特：
+ * 第 i 个比特位于 bytes[i / 8] 的第 (7 - i % 8) 位。
+ *
+ * - CRC-16: 多项式 x^16 + x^12 + x^5 + 1 (0x1021)，预置 0xFFFF，结果取反；
+ *   按 slice-by-4 查表，每次处理 4 个字节。
+ * - CRC-5:  多项式 x^5 + x^3 + 1 (0x09)，预置 01001；按字节查表，尾部不足一字节的比特逐位处理。
+ *
+ * 查表均为编译期常量，计算过程不做任何堆分配。
+ */
+
+// 计算 n_bytes 个字节的 CRC-16（已取反，可直接附加到报文末尾）
+uint16_t crc16(const uint8_t* bytes, size_t n_bytes);
+
+// 报文最后两个字节为 CRC-16 时校验整条报文
+bool crc16_check(const uint8_t* bytes, size_t n_bytes);
+
+// 计算前 n_bits 个比特的 CRC-5（低 5 位有效）
+uint8_t crc5(const uint8_t* bytes, size_t n_bits);
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_CRC_H */
@@ -6,42 +6,108 @@
  */
 
 #include "gate_impl.h"
+#include "line_code.h"
+#include <gnuradio/filter/firdes.h>
 #include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+#include <atomic>
+#include <stdexcept>
+#include <numeric>
+#include <cmath>
 namespace gr {
 namespace reader {
 
 using input_type = gr_complex;
 using output_type = gr_complex;
 
-gate::sptr gate::make(float sample_rate)
+// 突发标签的键只 intern 一次
+static const pmt::pmt_t SOB_KEY       = pmt::mp(BURST_SOB_KEY);
+static const pmt::pmt_t EOB_KEY       = pmt::mp(BURST_EOB_KEY);
+static const pmt::pmt_t DC_KEY        = pmt::mp(BURST_DC_KEY);
+
+// 每种标签值最多保留的个数：输出缓冲只放得下两个窗口，正常情况下池子远用不满
+static const size_t TAG_VALUE_POOL = 8;
+
+gate::sptr gate::make(READER_STATE::sptr reader_state, float sample_rate, int decimation)
 {
-    return gnuradio::make_block_sptr<gate_impl>(sample_rate);
+    return gnuradio::make_block_sptr<gate_impl>(reader_state, sample_rate, decimation);
 }
 
 /*
  * The private constructor
  */
-gate_impl::gate_impl(float sample_rate)
+gate_impl::gate_impl(READER_STATE::sptr state, float sample_rate, int decimation)
     : gr::block("gate",
                 gr::io_signature::make(
                     1 /* min inputs */, 1 /* max inputs */, sizeof(input_type)),
                 gr::io_signature::make(
                     1 /* min outputs */, 1 /*max outputs */, sizeof(output_type))),
-    n_samples(0), win_index(0), dc_index(0),  avg_ampl(0), num_pulses(0), dc_est(0,0), signal_state(NEG_EDGE)
+    n_samples(0), dc_index(0), decim(decimation), dec_filter(std::vector<float>(1, 1.0)),
+    avg_ampl(0), num_pulses(0), dc_est(0,0), noise_power(0), signal_state(NEG_EDGE), reader_state(state),
+    window_type(DECODER_DECODE_RN16), n_samples_to_ungate(0), max_window(0), window_open(false), burst_seq(0),
+    preamble(1), eob_next(0), eob_block(1), eob_index(0), eob_threshold(0), rx_clock(0), cmd_pending(false), cmd_end_rx(0), timeline_locked(false),
+    rx_latency(0), n_cal(0), timeline_misses(0), low_sum(0), high_sum(0), low_count(0), high_count(0),
+    close_rx(0), close_type(-1), air_path(-1), cmd_len_rx(0)
 {
-    n_samples_T1       = T1_D       * (sample_rate / pow(10,6));
-    n_samples_PW       = PW_D       * (sample_rate / pow(10,6));
-    n_samples_TAG_BIT  = TAG_BIT_D  * (sample_rate / pow(10,6));
+    if (decimation < 1)
+        throw std::invalid_argument("gate: decimation must be >= 1");
+
+    // 抽取后的低通：通带覆盖 PIE 边沿与 FM0/Miller 回波，过渡带落在新 Nyquist 之内
+    if (decim > 1)
+    {
+        float out_rate = sample_rate / decim;
+        dec_filter.set_taps(gr::filter::firdes::low_pass(1.0, sample_rate, 0.4 * out_rate, 0.2 * out_rate));
+        set_history(dec_filter.ntaps());
+        dec_samples.resize(GATE_CHUNK_SIZE);
+    }
+    sample_rate = sample_rate / decim;
+    s_rate = sample_rate;
 
     win_length = WIN_SIZE_D * (sample_rate/ pow(10,6));
-    dc_length  = DC_SIZE_D  * (sample_rate / pow(10,6));
 
-    win_samples.resize(win_length);
-    dc_samples.resize(dc_length);
-    
-    // First block to be scheduled
-    GR_LOG_INFO(d_logger, "Initializing reader state...");
-    initialize_reader_state();
+    env_samples.resize(win_length + GATE_CHUNK_SIZE);
+    avg_samples.resize(GATE_CHUNK_SIZE);
+
+    // 输入输出之间没有固定的样点对应关系，上游标签不向下游传播；输出上只有突发标签
+    set_tag_propagation_policy(TPP_DONT);
+
+    // tag_decoder 等整个突发都进了输入缓冲才解，输出缓冲至少放下两个最长的 EPC 窗口（一个在解、一个在写）。
+    // 缓冲在启动后不能再改，按所有链路参数取最长，运行中切换 profile 不会超出
+    max_window = max_reply_window_samples(sample_rate);
+    set_min_output_buffer(0, 2 * max_window);
+
+    sob_values.reserve(TAG_VALUE_POOL);
+    dc_values.reserve(TAG_VALUE_POOL);
+    eob_values.reserve(TAG_VALUE_POOL);
+
+    set_link(reader_state->link);
+}
+
+void gate_impl::set_link(const LINK_PARAMS& l)
+{
+    if (reply_window_samples(l, EPC_BITS, l.tag_bit_d() * (s_rate / pow(10,6))) > max_window)
+        throw std::invalid_argument("gate: reply window of this link profile exceeds the output buffer");
+    link = l;
+
+    n_samples_T1       = link.t1_d        * (s_rate / pow(10,6));
+    n_samples_PW       = link.pw_d()      * (s_rate / pow(10,6));
+    n_samples_TAG_BIT  = link.tag_bit_d() * (s_rate / pow(10,6));
+    preamble.set_samples_per_bit(n_samples_TAG_BIT);
+
+    // DC 只在 T1 的后半段估计，避免混入命令末尾的 PIE 脉冲
+    dc_length = std::max(1.0, std::min<double>(DC_SIZE_D, link.t1_d / 2) * (s_rate / pow(10,6)));
+    dc_samples.assign(dc_length, gr_complex(0, 0));
+    dc_index = 0;
+
+    // 窗口开头覆盖起点搜索范围 + pilot + 前导码 + 1 bit 余量，这段内没有前导码时提前关门
+    n_samples_detect = window_samples(0);
+    head_samples.resize(n_samples_detect);
+    preamble.reserve(n_samples_detect);
+}
+
+int gate_impl::window_samples(int data_bits) const
+{
+    return reply_window_samples(link, data_bits, n_samples_TAG_BIT);
 }
 
 /*
@@ -51,7 +117,7 @@ gate_impl::~gate_impl() {}
 
 void gate_impl::forecast(int noutput_items, gr_vector_int& ninput_items_required)
 {
-    ninput_items_required[0] = noutput_items;
+    ninput_items_required[0] = noutput_items * decim + history() - 1;
 }
 
 int gate_impl::general_work(int noutput_items,
@@ -62,109 +128,493 @@ int gate_impl::general_work(int noutput_items,
     auto in = static_cast<const input_type*>(input_items[0]);
     auto out = static_cast<output_type*>(output_items[0]);
 
-    int n_items = ninput_items[0];
+    // 门打开时每个（抽取后的）样点最多输出一个样点
+    int n_items = std::max(0, std::min((ninput_items[0] - (int)history() + 1) / decim, noutput_items));
     int number_samples_consumed = n_items;
-    float sample_ampl = 0;
     int written = 0;
 
-    // 终止条件判断
-    if( (reader_state-> reader_stats.n_queries_sent > MAX_NUM_QUERIES ||
-        reader_state-> reader_stats.tag_reads.size() > NUMBER_UNIQUE_TAGS) &&  
-        reader_state-> status != TERMINATED) 
+    // reader 写入的 SEEK 请求只被取走一次
+    GATE_STATUS seek = reader_state->gate_status.load(std::memory_order_acquire);
+    if ((seek == GATE_SEEK_EPC || seek == GATE_SEEK_RN16) &&
+        reader_state->gate_status.compare_exchange_strong(seek, GATE_CLOSED, std::memory_order_acq_rel))
     {
-        reader_state-> status = TERMINATED;
-        gettimeofday (&reader_state-> reader_stats.end, NULL);
-        std::cout << "| Execution time : " << reader_state-> reader_stats.end.tv_sec - reader_state-> reader_stats.start.tv_sec << " seconds" << std::endl;
-        GR_LOG_INFO(d_logger, "Termination");
-    }
+        // reader 在新一轮的 Query 之前可能切换了链路参数
+        if (reader_state->link.profile != link.profile)
+            set_link(reader_state->link);
 
-    if(reader_state->gate_status == GATE_SEEK_EPC)
-    {
-        GR_LOG_INFO(d_debug_logger, "GATE SEEK EPC");
-        reader_state->gate_status = GATE_CLOSED;
-        reader_state->n_samples_to_ungate = (EPC_BITS + TAG_PREAMBLE_BITS) * n_samples_TAG_BIT + 2*n_samples_TAG_BIT;
-        n_samples = 0;
-    }
-    else if (reader_state->gate_status == GATE_SEEK_RN16)
-    {
-        GR_LOG_INFO(d_debug_logger, "GATE SEEK RN16");
-        reader_state->gate_status = GATE_CLOSED;
-        reader_state->n_samples_to_ungate = (RN16_BITS + TAG_PREAMBLE_BITS) * n_samples_TAG_BIT + 2*n_samples_TAG_BIT;
+        // 上一个窗口之后是哪种转换：RN16 之后发了 ACK（SEEK EPC），或 EPC 之后的下一条命令
+        air_path = -1;
+        if (close_type == DECODER_DECODE_EPC)
+            air_path = TURNAROUND_EPC_NEXT;
+        else if (close_type == DECODER_DECODE_RN16 && seek == GATE_SEEK_EPC)
+            air_path = TURNAROUND_RN16_ACK;
+        close_type = -1;
+
+        if (seek == GATE_SEEK_EPC)
+        {
+            GR_LOG_INFO(d_debug_logger, "GATE SEEK EPC");
+            window_type = DECODER_DECODE_EPC;
+            n_samples_to_ungate = window_samples(EPC_BITS);
+        }
+        else
+        {
+            GR_LOG_INFO(d_debug_logger, "GATE SEEK RN16");
+            window_type = DECODER_DECODE_RN16;
+            n_samples_to_ungate = window_samples(RN16_BITS);
+        }
         n_samples = 0;
+
+        // 命令结束的 TX 序号换算到 RX 采样率；reader 没有发布时间线时只能靠包络检测
+        uint64_t tx_end = reader_state->tx_command_end;
+        double tx_rate = reader_state->tx_rate;
+        cmd_pending = (tx_end != TX_TIME_UNKNOWN && tx_rate > 0);
+        if (cmd_pending)
+        {
+            cmd_end_rx = tx_end * (s_rate / tx_rate);
+            cmd_len_rx = (tx_end - reader_state->tx_command_start) * (s_rate / tx_rate);
+        }
+        low_sum = high_sum = 0;
+        low_count = high_count = 0;
     }
 
     // 选取疑似的片段送给decoder解码
-    if (reader_state->status == RUNNING)
+    if (reader_state->status.load(std::memory_order_acquire) == RUNNING)
     {
-        for(int i = 0; i < n_items; i++)
+        number_samples_consumed = 0;
+        bool window_done = false;
+
+        // 幅度与滑窗均值按块计算，状态机只在门限穿越处推进
+        while (number_samples_consumed < n_items && !window_done)
         {
-            // Tracking average amplitude
-            sample_ampl = std::abs(in[i]);
-            avg_ampl = avg_ampl + (sample_ampl - win_samples[win_index])/win_length;  
-            win_samples[win_index] = sample_ampl; 
-            win_index = (win_index + 1) % win_length;
-            //Threshold for detecting negative/positive edges
-            sample_thresh = avg_ampl * THRESH_FRACTION;
-
-            if( !(reader_state->gate_status == GATE_OPEN) )
+            const gr_complex* chunk = in + number_samples_consumed;
+            int n = std::min(n_items - number_samples_consumed, GATE_CHUNK_SIZE);
+            int i = 0;
+
+            if (decim > 1)
             {
-                //Tracking DC offset (only during T1)
-                dc_est =  dc_est + (in[i] - dc_samples[dc_index])/std::complex<float>(dc_length,0);  
-                dc_samples[dc_index] = in[i]; 
-                dc_index = (dc_index + 1) % dc_length;
-        
-                n_samples++;
-
-                // Potitive edge -> Negative edge
-                if( sample_ampl < sample_thresh && signal_state == POS_EDGE)
-                {
-                    n_samples = 0;
-                    signal_state = NEG_EDGE;
-                }
-                // Negative edge -> Positive edge 
-                else if (sample_ampl > sample_thresh && signal_state == NEG_EDGE)
-                {
-                    signal_state = POS_EDGE;
-                    if (n_samples > n_samples_PW/2) num_pulses++;
-                    else num_pulses = 0;
-                    n_samples = 0;
-                }
+                // in[0, history-1) 为滤波器历史，抽取后的第 k 个样点对应新样点 k*decim
+                dec_filter.filterNdec(dec_samples.data(), in + number_samples_consumed * decim, n, decim);
+                chunk = dec_samples.data();
+            }
+
+            // 锁定后不再计算包络，门关闭期间每个样点只做 DC 跟踪
+            bool envelope = !timeline_locked;
+            if (envelope)
+                track_envelope(chunk, n);
+            uint64_t base = rx_clock + number_samples_consumed;
 
-                if(n_samples > n_samples_T1 && signal_state == POS_EDGE && num_pulses > NUM_PULSES_COMMAND)
+            while (i < n)
+            {
+                if (!window_open)
                 {
+                    int k = timeline_locked ? seek_timeline(chunk, base, i, n) : seek_command(i, n);
+                    //Tracking DC offset (only during T1)
+                    track_dc(chunk + i, std::min(k + 1, n) - i);
+                    if (k == n)
+                    {
+                        i = n;
+                        break;
+                    }
+
+                    if (timeline_locked)
+                        check_timeline();
+                    else if (cmd_pending)
+                        calibrate(base + k);
+                    if (cmd_pending)
+                        record_air_turnaround(base + k);
+                    cmd_pending = false;
+
                     GR_LOG_INFO(d_debug_logger, "READER COMMAND DETECTED");
-                    reader_state->gate_status = GATE_OPEN;
+                    reader_state->gate_status.store(GATE_OPEN, std::memory_order_relaxed);
+                    window_open = true;
 
-                    reader_state->magn_squared_samples.resize(0);
+                    dc_est = std::accumulate(dc_samples.begin(), dc_samples.end(), gr_complex(0,0)) / std::complex<float>(dc_length,0);
+                    noise_power = 0;
+                    for (const gr_complex& x : dc_samples)
+                        noise_power += std::norm(x - dc_est);
+                    noise_power /= dc_length;
+                    tag_burst_start(nitems_written(0) + written, base + k);
 
+                    num_pulses = 0;
+                    n_samples = 0; // Count number of samples passed to the next block
+                    eob_next = 0;
+                    i = k;
+                }
 
-                    reader_state->magn_squared_samples.push_back(std::norm(in[i] - dc_est));
-                    out[written] = in[i] - dc_est;
-                    written++;
+                // Remove offset from complex samples
+                int m = std::min(n - i, n_samples_to_ungate - n_samples);
+                if (n_samples < n_samples_detect)
+                    m = std::min(m, n_samples_detect - n_samples);
+                if (eob_next > 0)
+                    m = std::min(m, eob_next - n_samples);
+                m = std::max(m, 1);
+                for (int j = 0; j < m; j++)
+                {
+                    out[written + j] = chunk[i + j] - dc_est;
+                }
+                if (n_samples < n_samples_detect)
+                    std::copy(out + written, out + written + m, head_samples.begin() + n_samples);
+                if (eob_next > 0)
+                {
+                    gr_complex e;
+                    volk_32fc_x2_conjugate_dot_prod_32fc(&e, out + written, out + written, m);
+                    eob_energy[eob_index] += std::real(e);
+                }
 
-                    num_pulses = 0; 
-                    n_samples =  1; // Count number of samples passed to the next block
+                written += m;
+                n_samples += m;
+                i += m;
+
+                // 过了 T1 最大值并覆盖前导码后仍没有回复：不再等待整个窗口，
+                // decoder 据此立即给出下一条命令，reader 截断剩余的 CW。
+                // 有回复时窗口只放行到回复的预期结束处，回波提前消失时在其后一个比特内关门
+                bool early = false;
+                if (n_samples == n_samples_detect)
+                {
+                    early = !reply_detected();
+                    if (early)
+                        GR_LOG_INFO(d_debug_logger, "NO REPLY, CLOSING GATE EARLY");
+                    else
+                        expect_reply_end();
+                }
+                else if (n_samples == eob_next)
+                {
+                    early = reply_ended();
+                    if (early)
+                        GR_LOG_INFO(d_debug_logger, "REPLY ENDED, CLOSING GATE EARLY");
                 }
-            } 
-            else
-            {
-                n_samples++;
-                reader_state->magn_squared_samples.push_back(std::norm(in[i] - dc_est));
 
-                out[written] = in[i] - dc_est; // Remove offset from complex samples           
-                written++;
-                if (n_samples >= reader_state->n_samples_to_ungate)
+                if (early || n_samples >= n_samples_to_ungate)
                 {
-                    reader_state->gate_status = GATE_CLOSED;    
-                    number_samples_consumed = i+1;
+                    // 结束突发：decoder 直接在调度器的输入缓冲上解码，EOB 标签给出窗口长度
+                    uint64_t eob = nitems_written(0) + written - 1;
+                    size_t len;
+                    const pmt::pmt_t& eob_value = reusable_value(eob_values, [] { return pmt::make_u64vector(N_EOB_FIELDS, 0); });
+                    uint64_t* fields = pmt::u64vector_writable_elements(eob_value, len);
+                    fields[EOB_LENGTH]   = n_samples;
+                    fields[EOB_CLOSE_NS] = wall_clock_ns();
+                    add_item_tag(0, eob, EOB_KEY, eob_value);
+                    sob_open.reset();
+                    window_open = false;
+                    close_rx = base + i;
+                    close_type = window_type;
+                    reader_state->gate_status.store(GATE_CLOSED, std::memory_order_relaxed);
+                    window_done = true;
                     break;
                 }
             }
+
+            if (envelope && !timeline_locked)
+                advance_envelope(i);
+            number_samples_consumed += i;
         }
     }
-    consume_each (number_samples_consumed);
+    rx_clock += number_samples_consumed;
+    consume_each (number_samples_consumed * decim);
     return written;
 }
 
+void gate_impl::tag_burst_start(uint64_t offset, uint64_t rx_sample)
+{
+    size_t len;
+    const pmt::pmt_t& sob = reusable_value(sob_values, [] { return pmt::make_u64vector(N_SOB_FIELDS, 0); });
+    uint64_t* fields = pmt::u64vector_writable_elements(sob, len);
+    fields[SOB_SEQ]       = burst_seq++;
+    fields[SOB_TYPE]      = window_type;
+    fields[SOB_LINK]      = link.profile;
+    fields[SOB_RX_SAMPLE] = rx_sample;
+    fields[SOB_SYNC]      = 0;
+    add_item_tag(0, offset, SOB_KEY, sob);
+    sob_open = sob;
+
+    const pmt::pmt_t& dc = reusable_value(dc_values, [] { return pmt::make_c32vector(1, gr_complex(0, 0)); });
+    pmt::c32vector_writable_elements(dc, len)[0] = dc_est;
+    add_item_tag(0, offset, DC_KEY, dc);
+}
+
+const pmt::pmt_t& gate_impl::reusable_value(std::vector<pmt::pmt_t>& pool, pmt::pmt_t (*make)())
+{
+    // 只剩池子自己持有的值可以改写；其它线程在放手之前的读取要先于这里的写入
+    for (const pmt::pmt_t& v : pool)
+    {
+        if (v.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return v;
+        }
+    }
+    // 都还在下游：新建一个。池子满了就换掉第一个，旧值由仍持有它的标签释放
+    if (pool.size() < TAG_VALUE_POOL)
+    {
+        pool.push_back(make());
+        return pool.back();
+    }
+    pool.front() = make();
+    return pool.front();
+}
+
+void gate_impl::track_envelope(const gr_complex* in, int n)
+{
+    // env_samples[0, win_length) 保存前 win_length 个样点的幅度，当前块幅度紧随其后
+    float* hist = env_samples.data();
+    float* magn = hist + win_length;
+    volk_32fc_magnitude_32f(magn, in, n);
+
+    // Tracking average amplitude（滑窗递推，hist[k] 为 win_length 之前移出窗口的幅度）
+    float avg = avg_ampl;
+    for (int k = 0; k < n; k++)
+    {
+        avg = avg + (magn[k] - hist[k]) / win_length;
+        avg_samples[k] = avg;
+    }
+}
+
+void gate_impl::advance_envelope(int n)
+{
+    if (n <= 0) return;
+    avg_ampl = avg_samples[n-1];
+    std::memmove(env_samples.data(), env_samples.data() + n, win_length * sizeof(float));
+}
+
+void gate_impl::track_dc(const gr_complex* in, int n)
+{
+    if (n >= dc_length)
+    {
+        std::copy(in + n - dc_length, in + n, dc_samples.begin());
+        dc_index = 0;
+        return;
+    }
+    int first = std::min(n, dc_length - dc_index);
+    std::copy(in, in + first, dc_samples.begin() + dc_index);
+    std::copy(in + first, in + n, dc_samples.begin());
+    dc_index = (dc_index + n) % dc_length;
+}
+
+void gate_impl::record_air_turnaround(uint64_t open)
+{
+    if (air_path < 0)
+        return;
+    // 窗口在命令结束之后 T1 处打开，命令起点再往前推一个命令长度
+    double start = (double) open - n_samples_T1 - cmd_len_rx;
+    double gap = std::max(0.0, start - (double) close_rx);
+    reader_state->latency.at((TURNAROUND) air_path, LAT_AIR).record((uint64_t) (gap / s_rate * 1e9));
+    air_path = -1;
+}
+
+bool gate_impl::reply_detected()
+{
+    preamble.load(head_samples.data(), n_samples_detect);
+    float span = (PREAMBLE_SEARCH_BITS + link.pilot_bits()) * n_samples_TAG_BIT;
+    switch (link.m)
+    {
+    case 0:  reply = preamble.search<fm0>(span, BLF_TOLERANCE);     break;
+    case 1:  reply = preamble.search<miller2>(span, BLF_TOLERANCE); break;
+    case 2:  reply = preamble.search<miller4>(span, BLF_TOLERANCE); break;
+    default: reply = preamble.search<miller8>(span, BLF_TOLERANCE); break;
+    }
+
+    // decoder 的同步在同一段样点上做同样的搜索：结果随 SOB 交给它，不再重复。
+    // 这里写的字段在 EOB 标签之前，decoder 等到 EOB 才读
+    size_t len;
+    uint64_t* fields = pmt::u64vector_writable_elements(sob_open, len);
+    fields[SOB_SYNC_START]   = float_field(reply.start);
+    fields[SOB_SYNC_T]       = float_field(reply.T);
+    fields[SOB_SYNC_QUALITY] = float_field(reply.quality);
+    fields[SOB_SYNC_H_RE]    = float_field(reply.h.real());
+    fields[SOB_SYNC_H_IM]    = float_field(reply.h.imag());
+    fields[SOB_SYNC]         = 1;
+    return preamble_detected(reply);
+}
+
+void gate_impl::expect_reply_end()
+{
+    // 前导码之后还有数据比特（含 dummy bit），周期用前导码的估计值
+    int data_bits = (window_type == DECODER_DECODE_EPC) ? EPC_BITS : RN16_BITS;
+    float end = reply.start + (link.preamble_bits() + data_bits) * reply.T * (1 + REPLY_T_TOLERANCE)
+              + REPLY_TAIL_BITS * reply.T;
+    n_samples_to_ungate = std::max(n_samples, std::min(n_samples_to_ungate, (int) std::ceil(end)));
+
+    // 回复期间 DC 已去除的 |x|^2 均值约为 |h|^2 加噪声，回波全部结束后只剩噪声
+    eob_block = std::max(1, (int) reply.T);
+    eob_threshold = EOB_NOISE_RATIO * noise_power * EOB_BITS * eob_block;
+    eob_next = (std::norm(reply.h) * EOB_BITS * eob_block >= EOB_MIN_SNR * eob_threshold) ? n_samples + eob_block : 0;
+    if (eob_next == 0)
+        return;
+
+    // 之前 EOB_BITS - 1 个比特的能量取自窗口开头的缓存（最早的比特放在下一个要覆盖的位置），之后随输出逐比特累加
+    eob_index = 0;
+    eob_energy.fill(0);
+    for (int b = 1; b < EOB_BITS; b++)
+    {
+        int end = std::max(0, n_samples - (b - 1) * eob_block);
+        for (int j = std::max(0, end - eob_block); j < end; j++)
+            eob_energy[EOB_BITS - b] += std::norm(head_samples[j]);
+    }
+}
+
+bool gate_impl::reply_ended()
+{
+    float e = std::accumulate(eob_energy.begin(), eob_energy.end(), 0.0f);
+    if (e < eob_threshold)
+        return true;
+    eob_index = (eob_index + 1) % EOB_BITS;
+    eob_energy[eob_index] = 0;
+    eob_next += eob_block;
+    return false;
+}
+
+int gate_impl::find_below(int begin, int end) const
+{
+    const float* magn = env_samples.data() + win_length;
+    int k = begin;
+    // 先以 8 个样点为一组做无分支比较，命中后再逐点定位
+    for (; k + 8 <= end; k += 8)
+    {
+        int hit = 0;
+        for (int j = 0; j < 8; j++) hit |= magn[k+j] < avg_samples[k+j] * THRESH_FRACTION;
+        if (hit) break;
+    }
+    for (; k < end; k++)
+    {
+        if (magn[k] < avg_samples[k] * THRESH_FRACTION) return k;
+    }
+    return end;
+}
+
+int gate_impl::find_above(int begin, int end) const
+{
+    const float* magn = env_samples.data() + win_length;
+    int k = begin;
+    for (; k + 8 <= end; k += 8)
+    {
+        int hit = 0;
+        for (int j = 0; j < 8; j++) hit |= magn[k+j] > avg_samples[k+j] * THRESH_FRACTION;
+        if (hit) break;
+    }
+    for (; k < end; k++)
+    {
+        if (magn[k] > avg_samples[k] * THRESH_FRACTION) return k;
+    }
+    return end;
+}
+
+int gate_impl::seek_timeline(const gr_complex* in, uint64_t base, int begin, int end)
+{
+    if (!cmd_pending)
+        return end;
+
+    // 命令在 RX 上的结束位置；包络检测同样在最后一个上升沿之后 T1 处开门
+    double edge = cmd_end_rx + rx_latency;
+    int64_t target = std::llround(edge) + n_samples_T1 - (int64_t) base;
+    int k = (int) std::max<int64_t>(begin, std::min<int64_t>(end, target));
+
+    // 累加落在本段 [begin, k) 内的校验区间：最后一个 PIE 低电平的中间一半、CW 的前半个 T1
+    auto accumulate = [&](double t0, double t1, float& sum, int& count) {
+        int64_t j0 = std::max<int64_t>(begin, (int64_t) std::ceil(t0) - (int64_t) base);
+        int64_t j1 = std::min<int64_t>(k, (int64_t) std::ceil(t1) - (int64_t) base);
+        for (int64_t j = j0; j < j1; j++)
+            sum += std::abs(in[j]);
+        count += std::max<int64_t>(0, j1 - j0);
+    };
+    accumulate(edge - 0.75 * n_samples_PW, edge - 0.25 * n_samples_PW, low_sum, low_count);
+    accumulate(edge + n_samples_PW, edge + n_samples_T1 / 2, high_sum, high_count);
+    return k;
+}
+
+void gate_impl::calibrate(uint64_t detected)
+{
+    double meas = (double) detected - n_samples_T1 - cmd_end_rx;
+    double tol = std::max(1.0, TIMELINE_CAL_TOL_D * s_rate / 1e6);
+
+    // 与之前的测量不一致时重新开始计数
+    for (int c = 0; c < n_cal; c++)
+    {
+        if (std::abs(meas - cal[c]) > tol)
+        {
+            n_cal = 0;
+            break;
+        }
+    }
+    cal[n_cal++] = meas;
+    if (n_cal < TIMELINE_CAL_COMMANDS)
+        return;
+
+    rx_latency = std::accumulate(cal.begin(), cal.end(), 0.0) / TIMELINE_CAL_COMMANDS;
+    timeline_locked = true;
+    timeline_misses = 0;
+    n_cal = 0;
+    d_logger->info("timeline locked, rx latency {} samples", rx_latency);
+}
+
+void gate_impl::check_timeline()
+{
+    // 开门位置已经错过校验区间时不作判断
+    if (low_count == 0 || high_count == 0)
+        return;
+    if (low_sum / low_count < THRESH_FRACTION * high_sum / high_count)
+    {
+        timeline_misses = 0;
+        return;
+    }
+    if (++timeline_misses < TIMELINE_MISS_LIMIT)
+        return;
+
+    // 失锁：窗口照常打开（decoder 会提前关门），之后回到包络检测并重新标定
+    GR_LOG_WARN(d_logger, "timeline lost, falling back to envelope detection");
+    timeline_locked = false;
+    timeline_misses = 0;
+    n_cal = 0;
+    std::fill(env_samples.begin(), env_samples.end(), 0.0f);
+    avg_ampl = 0;
+    signal_state = NEG_EDGE;
+    num_pulses = 0;
+}
+
+int gate_impl::seek_command(int begin, int end)
+{
+    int i = begin;
+    while (i < end)
+    {
+        if (signal_state == POS_EDGE)
+        {
+            // 若期间没有负边沿，第 fire 个样点处 n_samples 超过 T1 即判定为命令结束
+            int fire = end;
+            if (num_pulses > NUM_PULSES_COMMAND)
+                fire = i + std::max(0, n_samples_T1 - n_samples);
+            int stop = std::min(fire + 1, end);
+
+            // Potitive edge -> Negative edge
+            int k = find_below(i, stop);
+            if (k < stop)
+            {
+                n_samples = 0;
+                signal_state = NEG_EDGE;
+                i = k + 1;
+                continue;
+            }
+            n_samples += stop - i;
+            if (fire < end) return fire;
+            i = stop;
+        }
+        else
+        {
+            // Negative edge -> Positive edge
+            int k = find_above(i, end);
+            if (k == end)
+            {
+                n_samples += end - i;
+                break;
+            }
+            n_samples += k - i + 1;
+            signal_state = POS_EDGE;
+            if (n_samples > n_samples_PW/2) num_pulses++;
+            else num_pulses = 0;
+            n_samples = 0;
+            i = k + 1;
+        }
+    }
+    return end;
+}
+
 } /* namespace reader */
 } /* namespace gr */
@@ -8,8 +8,11 @@
 #ifndef INCLUDED_READER_GATE_IMPL_H
 #define INCLUDED_READER_GATE_IMPL_H
 
+#include "preamble_detector.h"
 #include <gnuradio/reader/gate.h>
+#include <gnuradio/filter/fir_filter.h>
 #include <gnuradio/reader/global_vars.h>
+#include <array>
 #include <vector>
 namespace gr {
 namespace reader {
@@ -20,25 +23,95 @@ private:
     // 边沿检测状态（门限穿越计数）
     enum SIGNAL_STATE { NEG_EDGE, POS_EDGE };
 
-    // 关键样点数（由 us * sample_rate / 1e6 换算）
-    int n_samples, n_samples_T1, n_samples_PW, n_samples_TAG_BIT;
+    // 关键样点数（由 us * sample_rate / 1e6 换算，随链路参数变化）
+    int n_samples, n_samples_T1, n_samples_PW;
+    float n_samples_TAG_BIT;
+    LINK_PARAMS link;      // 当前窗口使用的链路参数（reader 随 SEEK 发布）
 
-    // 窗口索引/长度与采样率
-    int win_index, dc_index, win_length, dc_length, s_rate;
+    // 窗口索引/长度与采样率（s_rate 为抽取后的速率）
+    int dc_index, win_length, dc_length, s_rate;
+
+    // 前端多相抽取：只计算保留下来的输出样点
+    int decim;
+    gr::filter::kernel::fir_filter_ccf dec_filter;
+    std::vector<gr_complex> dec_samples;
 
     // 自适应门限与脉冲计数
-    float avg_ampl, num_pulses, sample_thresh;
+    float avg_ampl, num_pulses;
 
-    // 缓冲：滑窗幅度/能量、CW记录、DC估计
-    std::vector<float> win_samples, cw_samples; // win 滑动窗口求平均值
-    std::vector<gr_complex> dc_samples;
+    // 缓冲：env_samples = [前 win_length 个幅度历史 | 当前块幅度]，avg_samples 为逐样点滑窗均值
+    std::vector<float> env_samples, avg_samples;
+    std::vector<gr_complex> dc_samples; // DC 估计环形缓冲（只记录门关闭期间的样点）
     gr_complex dc_est;     // DC偏置估计（输出常用 x - dc_est）
+    float noise_power;     // 开门前 DC 缓冲内 |x - dc_est|^2 的均值（回复结束检测的噪声底）
 
     SIGNAL_STATE signal_state; // 当前等待的边沿类型
 
+    READER_STATE::sptr reader_state; // 与同组 reader/tag_decoder 共享的上下文
+
+    // 当前窗口：类型、放行长度；门打开期间 window_open 为真，输出为一个尚未结束的突发
+    DECODER_STATUS window_type;
+    int n_samples_to_ungate;
+    int max_window;                         // 输出缓冲能容纳的最长窗口（samples）
+    bool window_open;
+    uint64_t burst_seq;                     // 下一个突发的序号
+
+    // 突发标签的值在小池子里轮换：调度器的标签表和 decoder 都放手（use_count() == 1）后原地改写，
+    // 稳态下不再为标签值分配内存
+    std::vector<pmt::pmt_t> sob_values, dc_values, eob_values;
+
+    // 提前关门：窗口开头 n_samples_detect 个样点内没有前导码时立即发布窗口（空 slot / 无回复）
+    int n_samples_detect;
+    std::vector<gr_complex> head_samples;   // 当前窗口开头的样点（可能跨多次 work 调用）
+    preamble_detector preamble;
+    preamble_sync reply;                    // 当前窗口的前导码同步结果
+    pmt::pmt_t sob_open;                    // 当前窗口的 SOB 值：持有期间标签值池不会复用它，检测后写入同步字段
+
+    // 回复结束检测：检测到前导码之后每个比特（eob_block 个样点）检查一次最近 EOB_BITS 个比特的 |x|^2 之和，
+    // eob_next 为下一个检查点（0 为不检查）。|x|^2 只在检测期间按比特累加，eob_energy[eob_index] 为当前比特
+    int eob_next, eob_block, eob_index;
+    float eob_threshold;
+    std::array<float, EOB_BITS> eob_energy;
+
+    // TX/RX 时间线：reader 随 SEEK 发布命令结束的 TX 样点序号，标定收发延迟后直接按序号开门，
+    // 包络检测只用于标定和失锁后的回退
+    uint64_t rx_clock;         // 已消耗的（抽取后）样点数，即本次 work 第一个样点的 RX 序号
+    bool cmd_pending;          // 已取走 SEEK、窗口尚未打开，且 cmd_end_rx 有效
+    double cmd_end_rx;         // 命令结束（最后一个上升沿）换算到 RX 采样率的序号，不含延迟
+    bool timeline_locked;
+    double rx_latency;         // 收发延迟（RX 样点），锁定时为各次标定的均值
+    std::array<double, TIMELINE_CAL_COMMANDS> cal; // 最近几次一致的延迟测量
+    int n_cal, timeline_misses;
+    float low_sum, high_sum;   // 锁定后校验：命令最后一个 PIE 低电平 / 其后 CW 的幅度累加
+    int low_count, high_count;
+
+    // 转换延迟（样点时间）：上一个窗口关门的 RX 序号与类型（-1 为没有），
+    // 以及本次 SEEK 对应的转换（-1 为不计）和命令长度（RX 样点）
+    uint64_t close_rx;
+    int close_type;
+    int air_path;
+    double cmd_len_rx;
+
+    void track_envelope(const gr_complex* in, int n);   // 整块计算 |x| 与滑窗均值
+    void advance_envelope(int n);                       // 提交前 n 个样点的包络状态
+    void track_dc(const gr_complex* in, int n);         // 把门关闭期间的样点写入 DC 缓冲
+    int seek_command(int begin, int end);               // 按块搜索门限穿越，返回命令结束样点或 end
+    int find_below(int begin, int end) const;
+    int find_above(int begin, int end) const;
+    int seek_timeline(const gr_complex* in, uint64_t base, int begin, int end); // 锁定后按序号定位窗口起点
+    void calibrate(uint64_t detected);                  // 包络检测到命令时测量收发延迟
+    void check_timeline();                              // 锁定后开门时校验命令末尾，连续失败则失锁
+    void record_air_turnaround(uint64_t open);          // 开门时记录上一个窗口结束到本条命令开始的间隔
+    bool reply_detected();                              // 在 head_samples 上检测前导码
+    void expect_reply_end();                            // 按前导码同步结果收紧窗口长度并开始回复结束检测
+    bool reply_ended();                                 // 检查点之前的一个比特内没有回波
+    int window_samples(int data_bits) const;            // 含起点搜索、pilot 与前导码在内的窗口长度
+    void tag_burst_start(uint64_t offset, uint64_t rx_sample); // 在窗口第一个输出样点上打 SOB 与 DC 标签
+    static const pmt::pmt_t& reusable_value(std::vector<pmt::pmt_t>& pool, pmt::pmt_t (*make)()); // 取池中没有别处引用的标签值
+    void set_link(const LINK_PARAMS& l);                // 按链路参数换算 T1/PW/比特周期与各缓冲长度
 
 public:
-    gate_impl(float sample_rate);
+    gate_impl(READER_STATE::sptr state, float sample_rate, int decimation);
     ~gate_impl();
 
     // Where all the action really happens
@@ -7,31 +7,106 @@
 
 #include <gnuradio/io_signature.h>
 #include <gnuradio/reader/global_vars.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
 
 namespace gr {
 namespace reader {
-    READER_STATE * reader_state;
-    void initialize_reader_state()
+    // 具名链路参数，按 LINK_PROFILE 顺序排列
+    //   BLF40_FM0 : 原先的固定参数（Tari 24 us，BLF = 8 / 200 us = 40 kHz）
+    //   BLF160_FM0: Tari 12.5 us，TRcal 50 us
+    //   BLF320_FM0: Tari 6.25 us，TRcal 25 us
+    //   BLF640_FM0: Tari 6.25 us，DR = 64/3，TRcal 33.3 us（Gen2 允许的最高 BLF）
+    //   BLF160_M2 : Tari 12.5 us，TRcal 50 us，Miller-2（80 kbps）
+    //   BLF256_M4 : Tari 25 us，DR = 64/3，TRcal 83.3 us，Miller-4（64 kbps）
+    //   BLF320_M8 : Tari 12.5 us，DR = 64/3，TRcal 66.7 us，Miller-8（40 kbps）
+    // Miller 的几组都带 pilot（TRext = 1），给前导码同步留出副载波建立的时间
+    // T1 取标称值 max(RTcal, 10 Tpri) 的约 96%，T2 约 19 Tpri
+    static const LINK_PARAMS LINK_PROFILES[] =
     {
-        reader_state = new READER_STATE;
+        // profile          tari   trcal    dr m  trext t1    t2
+        { LINK_BLF40_FM0,  24.0f, 200.0f,   0, 0, 0,    240,  480 },
+        { LINK_BLF160_FM0, 12.5f,  50.0f,   0, 0, 0,     60,  120 },
+        { LINK_BLF320_FM0, 6.25f,  25.0f,   0, 0, 0,     30,   60 },
+        { LINK_BLF640_FM0, 6.25f, 100.0f/3, 1, 0, 0,     18,   30 },
+        { LINK_BLF160_M2,  12.5f,  50.0f,   0, 1, 1,     60,  120 },
+        { LINK_BLF256_M4,  25.0f, 250.0f/3, 1, 2, 1,     72,   75 },
+        { LINK_BLF320_M8,  12.5f, 200.0f/3, 1, 3, 1,     36,   60 },
+    };
+
+    LINK_PARAMS link_params(LINK_PROFILE profile)
+    {
+        if (profile < 0 || profile >= (int) (sizeof(LINK_PROFILES) / sizeof(LINK_PROFILES[0])))
+            throw std::invalid_argument("link_params: unknown link profile");
+        return LINK_PROFILES[profile];
+    }
+
+    int max_reply_window_samples(float sample_rate)
+    {
+        int n = 0;
+        for (const LINK_PARAMS& link : LINK_PROFILES)
+            n = std::max(n, reply_window_samples(link, EPC_BITS, link.tag_bit_d() * (sample_rate / 1e6f)));
+        return n;
+    }
+
+    READER_STATE::sptr READER_STATE::make(int max_tags)
+    {
+        READER_STATE::sptr reader_state = std::make_shared<READER_STATE>();
 
         reader_state-> reader_stats.n_queries_sent = 0;
         reader_state-> reader_stats.n_epc_correct = 0;
+        reader_state-> reader_stats.n_slots_empty = 0;
+        reader_state-> reader_stats.n_slots_single = 0;
+        reader_state-> reader_stats.n_slots_collision = 0;
         reader_state->reader_stats.unique_tags_round.clear();
-        reader_state->reader_stats.tag_reads.clear();
+        // 每轮至少一条 Query，轮数不会超过终止前的 Query 数
+        reader_state->reader_stats.unique_tags_round.reserve(MAX_NUM_QUERIES + 1);
+        reader_state->reader_stats.tag_reads.reset(max_tags);
  
         reader_state-> status            = RUNNING;
         reader_state-> gen2_logic_status = START;
         reader_state-> gate_status       = GATE_SEEK_RN16;
-        reader_state-> decoder_status    = DECODER_DECODE_RN16;
 
-        reader_state-> reader_stats.max_slot_number = pow(2,FIXED_Q);
+        reader_state-> link   = link_params(LINK_BLF40_FM0);
+        reader_state-> tx_command_start = TX_TIME_UNKNOWN;
+        reader_state-> tx_command_end = TX_TIME_UNKNOWN;
+        reader_state-> tx_rate        = 0;
+        reader_state-> turnaround_path = -1;
+        reader_state-> reply_close_ns  = 0;
+        reader_state-> decided_ns      = 0;
+        reader_state-> turnaround_seq  = 0;
+        reader_state-> q      = INITIAL_Q;
+        reader_state-> q_updn = 1;
+        reader_state-> reader_stats.max_slot_number = 1 << INITIAL_Q;
 
         reader_state-> reader_stats.cur_inventory_round = 1;
         reader_state-> reader_stats.cur_slot_number     = 1;
 
         gettimeofday (&reader_state-> reader_stats.start, NULL);
+        return reader_state;
+    }
+
+    void READER_STATE::set_gen2_logic_status(GEN2_LOGIC_STATUS s)
+    {
+        gen2_logic_status.store(s, std::memory_order_release);
+        // 加锁后再通知，避免 reader 检查完状态、尚未进入等待时丢失唤醒
+        std::lock_guard<std::mutex> lock(d_wake_mutex);
+        d_wake_cond.notify_all();
+    }
+
+    GEN2_LOGIC_STATUS READER_STATE::wait_gen2_logic_status(GEN2_LOGIC_STATUS s, int timeout_ms)
+    {
+        GEN2_LOGIC_STATUS cur = gen2_logic_status.load(std::memory_order_acquire);
+        if (cur != s) return cur;
+
+        std::unique_lock<std::mutex> lock(d_wake_mutex);
+        d_wake_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            cur = gen2_logic_status.load(std::memory_order_acquire);
+            return cur != s;
+        });
+        return cur;
     }
 } /* namespace reader */
 } /* namespace gr */
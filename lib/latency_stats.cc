@@ -0,0 +1,77 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 mzssbqd.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <gnuradio/reader/latency_stats.h>
+#include <algorithm>
+#include <cmath>
+
+namespace gr {
+namespace reader {
+
+    void latency_histogram::clear()
+    {
+        for (auto& b : d_buckets) b.store(0, std::memory_order_relaxed);
+        d_max.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t latency_histogram::count() const
+    {
+        uint64_t n = 0;
+        for (const auto& b : d_buckets) n += b.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    double latency_histogram::bucket_mid(int b)
+    {
+        if (b < LINEAR_BUCKETS)
+            return b;
+        int e = 4 + (b - LINEAR_BUCKETS) / (1 << SUB_BITS);
+        int s = (b - LINEAR_BUCKETS) % (1 << SUB_BITS);
+        double width = std::ldexp(1.0, e - SUB_BITS);
+        return ((1 << SUB_BITS) + s + 0.5) * width;
+    }
+
+    double latency_histogram::percentile(double p) const
+    {
+        // 先取一次各桶计数，之后的累加与总数一致
+        std::array<uint32_t, N_BUCKETS> counts;
+        uint64_t n = 0;
+        for (int b = 0; b < N_BUCKETS; b++)
+        {
+            counts[b] = d_buckets[b].load(std::memory_order_relaxed);
+            n += counts[b];
+        }
+        if (n == 0)
+            return 0;
+
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t) std::ceil(p * n));
+        uint64_t acc = 0;
+        int b = 0;
+        for (; b < N_BUCKETS - 1; b++)
+        {
+            acc += counts[b];
+            if (acc >= rank)
+                break;
+        }
+        return std::min(bucket_mid(b) / 1e3, max());
+    }
+
+    LATENCY_SUMMARY latency_stats::summary(TURNAROUND path, LATENCY_STAGE stage) const
+    {
+        const latency_histogram& h = at(path, stage);
+        return { h.count(), h.percentile(0.5), h.percentile(0.99), h.max() };
+    }
+
+    void latency_stats::clear()
+    {
+        for (auto& path : d_hist)
+            for (latency_histogram& h : path)
+                h.clear();
+    }
+
+} // namespace reader
+} // namespace gr
@@ -0,0 +1,146 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_LINE_CODE_H
+#define INCLUDED_READER_LINE_CODE_H
+
+#include <gnuradio/reader/global_vars.h>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace gr {
+namespace reader {
+
+// 基带编码器状态：上一比特结束时的电平（±1）与上一比特的值
+struct BASEBAND_STATE
+{
+    int level;
+    int prev;
+};
+
+/*
+ * 标签上行线路码。M = 1 为 FM0；M = 2/4/8 为 Miller-M（基带 Miller 乘以每比特 M 个周期的方波副载波）。
+ *
+ * 每个比特分为 CHIPS = 2M 个码片（FM0 即两个半比特），码片 j 的电平为所在半比特的基带电平乘以
+ * 副载波符号 subcarrier(j)。把半比特内的码片按副载波符号相加就得到该半比特的基带观测，
+ * 之后 FM0 与 Miller 只在基带电平的转移规则上不同：
+ *   FM0   ：比特起点必翻转，比特 0 在中点再翻转
+ *   Miller：比特 1 在中点翻转，两个连续的 0 之间翻转
+ * 解码内核（前导码搜索、比特判决、定时跟踪）以 line_code<M> 为模板参数，码片循环在编译期展开。
+ */
+template <int M>
+struct line_code
+{
+    static constexpr int SUBCARRIER     = M;
+    static constexpr int CHIPS          = 2 * M;
+    static constexpr int PREAMBLE_BITS  = (M == 1) ? TAG_PREAMBLE_BITS : MILLER_PREAMBLE_BITS;
+    static constexpr int PREAMBLE_CHIPS = PREAMBLE_BITS * CHIPS;
+
+    // 码片 j（0 <= j < CHIPS）上的副载波符号
+    static constexpr float subcarrier(int j) { return (M == 1 || j % 2 == 0) ? 1.0f : -1.0f; }
+
+    // 编码一个比特：给出两个半比特的基带电平并推进状态
+    static void encode(int bit, BASEBAND_STATE& s, int& first, int& second)
+    {
+        if (M == 1)
+        {
+            s.level = -s.level;
+            first = s.level;
+            if (bit == 0)
+                s.level = -s.level;
+            second = s.level;
+        }
+        else
+        {
+            if (bit == 0 && s.prev == 0)
+                s.level = -s.level;
+            first = s.level;
+            if (bit == 1)
+                s.level = -s.level;
+            second = s.level;
+        }
+        s.prev = bit;
+    }
+
+    // 由半比特观测的和 p = a + c 与差 m = a - c 判决：FM0 的比特 1 两个半比特同号，Miller 的比特 1 异号
+    static int decide(float p, float m)
+    {
+        return (M == 1) ? (std::abs(p) > std::abs(m)) : (std::abs(m) > std::abs(p));
+    }
+
+    // TRext = 1 时 pilot（FM0 12 个 0，Miller 16 个 0 中前导码之外的 12 个）的编码起始状态，
+    // 使 pilot 之后的前导码与 preamble_halves() 的电平一致
+    static BASEBAND_STATE pilot_state()
+    {
+        // FM0 的 0 不改变结束电平，前导码从高电平开始，故 pilot 从低电平开始；
+        // Miller 的 12 个 0 逐比特交替、以低电平结束，前导码的第一个 0 在边界翻回高电平
+        return (M == 1) ? BASEBAND_STATE{ -1, 0 } : BASEBAND_STATE{ 1, 1 };
+    }
+
+    // 前导码（FM0: 1010v1，含编码违例，直接取 TAG_PREAMBLE；Miller: 0000010111）的半比特电平
+    static const std::array<int8_t, 2 * PREAMBLE_BITS>& preamble_halves()
+    {
+        static const std::array<int8_t, 2 * PREAMBLE_BITS> halves = [] {
+            std::array<int8_t, 2 * PREAMBLE_BITS> h{};
+            if (M == 1)
+            {
+                for (int k = 0; k < 2 * PREAMBLE_BITS; k++)
+                    h[k] = TAG_PREAMBLE[k] ? 1 : -1;
+            }
+            else
+            {
+                static const int bits[MILLER_PREAMBLE_BITS] = { 0, 0, 0, 0, 0, 1, 0, 1, 1, 1 };
+                BASEBAND_STATE s = { 1, 1 };
+                for (int k = 0; k < PREAMBLE_BITS; k++)
+                {
+                    int a, c;
+                    encode(bits[k], s, a, c);
+                    h[2 * k] = a;
+                    h[2 * k + 1] = c;
+                }
+            }
+            return h;
+        }();
+        return halves;
+    }
+
+    // 前导码之后（第一个数据比特之前）的编码器状态
+    static BASEBAND_STATE preamble_end()
+    {
+        // 两种前导码都以比特 1 结束
+        return BASEBAND_STATE{ preamble_halves()[2 * PREAMBLE_BITS - 1], 1 };
+    }
+
+    // 前导码匹配滤波在码片边界前缀和上的差分权重：
+    // sum_j c_j (S(t+(j+1)L) - S(t+jL)) = sum_k (c_{k-1} - c_k) S(t+kL)，L 为码片长度
+    static const std::array<float, PREAMBLE_CHIPS + 1>& preamble_weights()
+    {
+        static const std::array<float, PREAMBLE_CHIPS + 1> weights = [] {
+            std::array<float, PREAMBLE_CHIPS + 1> w{};
+            auto chip = [](int j) { return preamble_halves()[j / M] * subcarrier(j % CHIPS); };
+            for (int k = 0; k <= PREAMBLE_CHIPS; k++)
+            {
+                float prev = (k > 0)              ? chip(k - 1) : 0.0f;
+                float cur  = (k < PREAMBLE_CHIPS) ? chip(k)     : 0.0f;
+                w[k] = prev - cur;
+            }
+            return w;
+        }();
+        return weights;
+    }
+};
+
+typedef line_code<1> fm0;
+typedef line_code<2> miller2;
+typedef line_code<4> miller4;
+typedef line_code<8> miller8;
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_LINE_CODE_H */
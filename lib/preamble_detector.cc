@@ -0,0 +1,319 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "preamble_detector.h"
+#include "line_code.h"
+#include <volk/volk.h>
+#include <algorithm>
+#include <cmath>
+
+namespace gr {
+namespace reader {
+
+// 周期细化的初始步进（相对标称周期）：前导码末端的累积误差约 1/4 码片。FM0（12 个码片）为 2%
+static const float T_REFINE_SPAN = 0.24;
+// 粗搜索每个码片的网格点数：起点最多偏 1/4 码片，相关峰仍远高于旁瓣
+static const int COARSE_POINTS_PER_CHIP = 2;
+// 局部细化的起点最小步进（samples）与迭代上限（正常情况下十几次就收敛）
+static const float REFINE_MIN_STEP = 0.25;
+static const int REFINE_MAX_ITER = 64;
+
+preamble_detector::preamble_detector(float samples_per_bit)
+    : T_nominal(samples_per_bit), samples(nullptr), n_loaded(0)
+{
+}
+
+void preamble_detector::reserve(int size)
+{
+    prefix.reserve(size + 1);
+    prefix_energy.reserve(size + 1);
+    lag_corr.reserve(size + 1);
+    // coarse_grid() 的网格步进不小于 1 个样点（码片不短于 1 个样点时），
+    // 网格点数不超过起点范围加前导码长度
+    grid.reserve(2 * size + 1);
+}
+
+void preamble_detector::load(const gr_complex* in, int size)
+{
+    samples = in;
+    n_loaded = size;
+    prefix.resize(size + 1);
+    prefix_energy.resize(size + 1);
+    // 累加放在局部变量里，避免每个样点都从刚写入的缓冲读回上一个前缀和
+    gr_complex s(0, 0);
+    float e = 0;
+    prefix[0] = s;
+    prefix_energy[0] = e;
+    for (int n = 0; n < size; n++)
+    {
+        s += in[n];
+        e += std::norm(in[n]);
+        prefix[n + 1] = s;
+        prefix_energy[n + 1] = e;
+    }
+}
+
+
+template <class CODE>
+gr_complex preamble_detector::correlate(float t, float T) const
+{
+    const auto& weights = CODE::preamble_weights();
+    const float L = T / CODE::CHIPS;
+    gr_complex corr(0, 0);
+    for (int k = 0; k <= CODE::PREAMBLE_CHIPS; k++)
+        corr += weights[k] * prefix_at(t + k * L);
+    return corr;
+}
+
+float preamble_detector::energy(float t0, float t1) const
+{
+    int n0 = (int) t0, n1 = (int) t1;
+    float e0 = prefix_energy[n0] + (t0 - n0) * (prefix_energy[n0 + 1] - prefix_energy[n0]);
+    float e1 = prefix_energy[n1] + (t1 - n1) * (prefix_energy[n1 + 1] - prefix_energy[n1]);
+    return e1 - e0;
+}
+
+template <class CODE>
+float preamble_detector::quality(float t, float T) const
+{
+    float length = CODE::PREAMBLE_BITS * T;
+    float e = energy(t, t + length);
+    return (e > 0) ? std::norm(correlate<CODE>(t, T)) / (length * e) : 0;
+}
+
+float preamble_detector::estimate_period(float cell, int end, float T_min, float T_max)
+{
+    // Miller 的 pilot（全 0）逐比特翻转电平，前导码开头的 0000 也是如此；副载波只在半比特边界
+    // 改变相位。因此 R(lag) = Re sum x[n] x*[n + lag] 在 lag = 2T 处为正峰、lag = T 处为负峰。
+    // 只看 R(2T) 时相邻副载波周期 2T ± 2L 处的峰只衰减到 1 - 2/M，低 SNR 下容易选错；
+    // 以 R(2T) - R(T) 为度量，错一个码片时 R(T ± L) 同号，度量降到约 -1/M。
+    // 自相关在长度为 cell 的积分单元上计算（单元不长于半个码片，副载波仍可分辨），
+    // 滞后与单元数都只取决于码片数，与采样率无关。在 lag = 2T 的单元网格上找最大值
+    // （R(T) 在半单元处取相邻两点均值），再做抛物线插值；细化交给 refine()
+    int n = (int) ((std::min(end, n_loaded) - 1) / cell);
+    int lag_lo = std::max(2, (int) std::floor(2 * T_min / cell));
+    int lag_hi = std::min(n - 1, (int) std::ceil(2 * T_max / cell));
+    if (lag_hi - lag_lo < 2)
+        return T_nominal;
+
+    // 单元积分借用 coarse_grid() 的网格缓冲（粗搜索在周期估计之后才覆盖它）
+    grid.resize(n);
+    gr_complex prev = prefix[0];
+    for (int i = 0; i < n; i++)
+    {
+        gr_complex next = prefix_at((i + 1) * cell);
+        grid[i] = next - prev;
+        prev = next;
+    }
+
+    // lag_corr[l] 为 R(l)，只计算 [lag_lo/2, lag_hi/2 + 1] 与 [lag_lo, lag_hi] 两段
+    lag_corr.resize(lag_hi + 1);
+    auto R = [this, n](int lag) {
+        gr_complex r;
+        volk_32fc_x2_conjugate_dot_prod_32fc(&r, grid.data(), grid.data() + lag, n - lag);
+        return std::real(r);
+    };
+    for (int l = lag_lo / 2; l <= lag_hi / 2 + 1; l++)
+        lag_corr[l] = R(l);
+    for (int l = std::max(lag_lo, lag_hi / 2 + 2); l <= lag_hi; l++)
+        lag_corr[l] = R(l);
+
+    auto score = [this](int lag) {
+        float r1 = (lag % 2) ? (lag_corr[lag / 2] + lag_corr[lag / 2 + 1]) / 2 : lag_corr[lag / 2];
+        return lag_corr[lag] - r1;
+    };
+
+    int best = lag_lo;
+    float best_s = score(lag_lo);
+    for (int lag = lag_lo + 1; lag <= lag_hi; lag++)
+    {
+        float s = score(lag);
+        if (s > best_s)
+        {
+            best_s = s;
+            best = lag;
+        }
+    }
+
+    float delta = 0;
+    if (best > lag_lo && best < lag_hi)
+    {
+        float prev_s = score(best - 1), next_s = score(best + 1);
+        float denom = prev_s - 2 * best_s + next_s;
+        if (denom < 0)
+            delta = std::max(-0.5f, std::min(0.5f, 0.5f * (prev_s - next_s) / denom));
+    }
+    return std::max(T_min, std::min(T_max, (best + delta) * cell / 2));
+}
+
+template <class CODE>
+float preamble_detector::coarse_grid(float T, int last, float& best_t, float& best_q)
+{
+    // 起点取在步进 g = L/K 的网格上（K 为每码片的网格点数），模板的每个码片边界也都落在网格上。
+    // 先求出每个网格点起的码片积分 D，再按副载波符号合并 M 个码片得到半比特观测 E，
+    // 前导码相关就只剩 2 * PREAMBLE_BITS 个半比特的加权和（逐码片计算需要 PREAMBLE_CHIPS + 1 次插值）。
+    // 网格点数只取决于起点范围有多少个码片，与采样率无关
+    const int M = CODE::SUBCARRIER;
+    const auto& halves = CODE::preamble_halves();
+    float L = T / CODE::CHIPS;
+    int K = std::max(1, std::min(COARSE_POINTS_PER_CHIP, (int) L));
+    float g = L / K;
+    int n_t = (int) (last / g) + 1;
+    int n_p = n_t - 1 + K * CODE::PREAMBLE_CHIPS;
+
+    // 原地依次变换：前缀和 -> 码片积分 D -> 半比特观测 E
+    grid.resize(n_p + 1);
+    for (int i = 0; i <= n_p; i++)
+        grid[i] = prefix_at(i * g);
+    for (int i = 0; i + K <= n_p; i++)
+        grid[i] = grid[i + K] - grid[i];
+    // Miller 的副载波每两个码片一个周期：先求 F[i] = D[i] - D[i + K]，再沿步进 2K 求后缀和 G，
+    // E[i] = G[i] - G[i + MK]（超出 F 末端的 G 为 0）。每个网格点 3 次加减，与 M 无关
+    if (M > 1)
+    {
+        int n_f = n_p + 1 - 2 * K;
+        for (int i = 0; i < n_f; i++)
+            grid[i] -= grid[i + K];
+        for (int i = n_f - 2 * K - 1; i >= 0; i--)
+            grid[i] += grid[i + 2 * K];
+        int n_e = n_t + K * M * (2 * CODE::PREAMBLE_BITS - 1);
+        for (int i = 0; i < std::min(n_e, n_f - M * K); i++)
+            grid[i] -= grid[i + M * K];
+    }
+
+    float length = CODE::PREAMBLE_BITS * T;
+    for (int i = 0; i < n_t; i++)
+    {
+        gr_complex corr(0, 0);
+        for (int h = 0; h < 2 * CODE::PREAMBLE_BITS; h++)
+            corr += (float) halves[h] * grid[i + K * M * h];
+        float e = energy(i * g, i * g + length);
+        float q = (e > 0) ? std::norm(corr) / (length * e) : 0;
+        if (q > best_q)
+        {
+            best_q = q;
+            best_t = i * g;
+        }
+    }
+    return g;
+}
+
+template <class CODE>
+void preamble_detector::refine(float& t, float& T, float& q, float dt, int last, float T_min, float T_max)
+{
+    // 在 (起点, 周期) 上做步长减半的模式搜索，每轮只看四个邻点：起点 ±dt，周期 ±dT。
+    // 改变周期时保持前导码中点不动，中点两侧的码片边界朝相反方向移动，起点与周期的误差近似解耦。
+    // 度量取 |corr|^2 / T（已知码型、未知复幅度时的最大似然）：quality() 再除以窗口能量，
+    // 窗口缩进前导码内部时少计了噪声，会偏向更短的周期
+    const float half = CODE::PREAMBLE_BITS / 2.0f;
+    const float dT_min = T_REFINE_SPAN / CODE::PREAMBLE_CHIPS * T_nominal / 4;
+    float dT = 4 * dT_min;
+    for (int iter = 0; iter < REFINE_MAX_ITER; iter++)
+    {
+        const float cand[4][2] = { { t - dt, T }, { t + dt, T },
+                                   { t + half * dT, T - dT }, { t - half * dT, T + dT } };
+        int best = -1;
+        for (int c = 0; c < 4; c++)
+        {
+            if (cand[c][0] < 0 || cand[c][0] > last || cand[c][1] < T_min || cand[c][1] > T_max)
+                continue;
+            float qc = std::norm(correlate<CODE>(cand[c][0], cand[c][1])) / cand[c][1];
+            if (qc > q)
+            {
+                q = qc;
+                best = c;
+            }
+        }
+        if (best >= 0)
+        {
+            t = cand[best][0];
+            T = cand[best][1];
+            continue;
+        }
+        if (dt <= REFINE_MIN_STEP && dT <= dT_min)
+            break;
+        dt = std::max(REFINE_MIN_STEP, dt / 2);
+        dT = std::max(dT_min, dT / 2);
+    }
+}
+
+template <class CODE>
+preamble_sync preamble_detector::search(float span, float tolerance)
+{
+    preamble_sync sync = { 0, T_nominal, CODE::PREAMBLE_BITS * T_nominal, 0, gr_complex(0, 0) };
+    float T_min = T_nominal * (1 - tolerance);
+    float T_max = T_nominal * (1 + tolerance);
+
+    // 保证最长周期下插值时 prefix[n + 1] 仍在窗口内
+    int last = std::min((int) span, (int) (n_loaded - CODE::PREAMBLE_BITS * T_max) - 2);
+    if (last < 0)
+        return sync;
+
+    // 粗搜索只在一个周期上做。FM0 取标称周期：BLF 偏差 5% 时前导码两端只错开 0.3 个码片，
+    // 相关峰仍在正确的起点上。Miller 的前导码长 20M 个码片，标称周期下两端错开 M 个码片，
+    // 先由自相关估计周期。自相关只取窗口开头 PREAMBLE_SEARCH_BITS + PREAMBLE_BITS 个比特：
+    // TRext 时起点范围后移了 pilot 长度，但这一段仍落在 pilot 与前导码内，代价不随 pilot 增长
+    float T = T_nominal;
+    if (CODE::SUBCARRIER > 1)
+        T = estimate_period(std::max(1.0f, T_nominal / (CODE::CHIPS * COARSE_POINTS_PER_CHIP)),
+                            (int) ((PREAMBLE_SEARCH_BITS + CODE::PREAMBLE_BITS) * T_max), T_min, T_max);
+    float t = 0, q = -1;
+    float g = coarse_grid<CODE>(T, last, t, q);
+
+    // 周期与亚网格起点只在粗峰附近细化
+    q = std::norm(correlate<CODE>(t, T)) / T;
+    refine<CODE>(t, T, q, g / 2, last, T_min, T_max);
+
+    // 抛物线插值得到亚采样起点
+    float delta = 0;
+    if (t >= 1 && t + 1 <= last)
+    {
+        float prev_val = std::abs(correlate<CODE>(t - 1, T));
+        float best_val = std::abs(correlate<CODE>(t, T));
+        float next_val = std::abs(correlate<CODE>(t + 1, T));
+        float denom = prev_val - 2 * best_val + next_val;
+        if (denom < 0)
+            delta = std::max(-0.5f, std::min(0.5f, 0.5f * (prev_val - next_val) / denom));
+    }
+
+    sync.start = t + delta;
+    sync.T = T;
+    sync.length = CODE::PREAMBLE_BITS * T;
+    sync.h = correlate<CODE>(sync.start, T) / sync.length;
+    sync.quality = quality<CODE>(sync.start, T);
+    return sync;
+}
+
+template preamble_sync preamble_detector::search<fm0>(float, float);
+template preamble_sync preamble_detector::search<miller2>(float, float);
+template preamble_sync preamble_detector::search<miller4>(float, float);
+template preamble_sync preamble_detector::search<miller8>(float, float);
+
+gr_complex integrate_samples(const gr_complex* in, float t0, float t1)
+{
+    int n0 = (int) t0, n1 = (int) t1;
+    if (n0 == n1)
+        return (t1 - t0) * in[n0];
+    gr_complex s = (n0 + 1 - t0) * in[n0];
+    for (int n = n0 + 1; n < n1; n++)
+        s += in[n];
+    return s + (t1 - n1) * in[n1];
+}
+
+float energy_samples(const gr_complex* in, float t0, float t1)
+{
+    int n0 = (int) t0, n1 = (int) t1;
+    if (n0 == n1)
+        return (t1 - t0) * std::norm(in[n0]);
+    float e = (n0 + 1 - t0) * std::norm(in[n0]);
+    for (int n = n0 + 1; n < n1; n++)
+        e += std::norm(in[n]);
+    return e + (t1 - n1) * std::norm(in[n1]);
+}
+
+} // namespace reader
+} // namespace gr
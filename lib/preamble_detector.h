@@ -0,0 +1,106 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_PREAMBLE_DETECTOR_H
+#define INCLUDED_READER_PREAMBLE_DETECTOR_H
+
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/reader/global_vars.h>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+// 前导码同步结果
+struct preamble_sync
+{
+    float start;        // 前导码第一个码片的起点（samples，亚采样精度）
+    float T;            // 估计的 tag 比特周期（samples/bit）
+    float length;       // 前导码长度（samples）
+    float quality;      // 归一化相关质量 |corr|^2 / (N * energy)，取值 [0,1]
+    gr_complex h;       // 码片复幅度（信道估计），与前导码模板中为 +1 的码片同号
+};
+
+// 检测判决：quality 乘以前导码样点数即相关能量与窗口平均能量之比，纯噪声时近似 Exp(1)
+inline bool preamble_detected(const preamble_sync& sync)
+{
+    return sync.quality * sync.length >= PREAMBLE_DETECT_THRESHOLD;
+}
+
+/*
+ * 前导码匹配滤波（积分-清零），线路码由模板参数 CODE（line_code.h）给出。
+ *
+ * 每个码片的积分由复前缀和 S[n] = sum_{k<n} x[k] 的两点差得到，
+ * N 个码片的相关可写成 N + 1 个前缀和的加权和，与采样率无关；
+ * 分数位置上的前缀和按零阶保持线性插值，因此可以在任意亚采样偏移上求值。
+ * 起点只在一个周期上做粗搜索（每码片 2 个网格点），比特周期与亚网格起点只在粗峰附近
+ * 用步长减半的模式搜索细化，最后对 |corr| 做抛物线插值得到亚采样起点。
+ *
+ * 粗搜索的周期：FM0 取标称值。Miller 前导码长 20M 个码片，标称周期下末端的累积误差
+ * 随 M 增长，先用 pilot / 前导码中 1 bit 与 2 bit 间隔的自相关估计比特周期。
+ * 自相关在半码片的积分单元上计算，各步的代价都只取决于码片数，与采样率无关。
+ */
+class preamble_detector
+{
+private:
+    float T_nominal;                        // 标称比特周期（samples）
+    const gr_complex* samples;              // load() 的输入窗口（search() 期间有效）
+    std::vector<gr_complex> prefix;         // 复前缀和
+    std::vector<float> prefix_energy;       // |x|^2 前缀和
+    std::vector<float> lag_corr;            // estimate_period() 的自相关缓冲
+    std::vector<gr_complex> grid;           // coarse_grid() 的网格缓冲
+    int n_loaded;                           // 已建立前缀和的样点数
+
+    // 位置 t 处的前缀和（零阶保持插值）；调用者保证 0 <= t < n_loaded
+    gr_complex prefix_at(float t) const
+    {
+        int n = (int) t;
+        return prefix[n] + (t - n) * (prefix[n + 1] - prefix[n]);
+    }
+    float energy(float t0, float t1) const;         // [t0, t1) 内的能量 sum |x|^2
+
+    template <class CODE>
+    gr_complex correlate(float t, float T) const;   // 起点 t、周期 T 的前导码相关值
+    template <class CODE>
+    float quality(float t, float T) const;          // 归一化相关质量
+    template <class CODE>
+    float coarse_grid(float T, int last, float& best_t, float& best_q);  // 粗搜索：周期 T 下 [0, last] 内所有网格起点，返回网格步进
+    template <class CODE>
+    void refine(float& t, float& T, float& q, float dt, int last, float T_min, float T_max); // 从 (t, T) 起局部细化，q 为 |corr|^2 / T，dt 为起点初始步进
+    float estimate_period(float cell, int end, float T_min, float T_max); // 由 1/2 bit 间隔的自相关估计 Miller 比特周期，cell 为积分单元长度
+
+public:
+    preamble_detector(float samples_per_bit);
+
+    // 切换链路参数后更新标称比特周期，从下一次 search() 开始生效
+    void set_samples_per_bit(float samples_per_bit) { T_nominal = samples_per_bit; }
+
+    // 为长度不超过 size 的窗口预留缓冲，之后的 load()/search() 不再分配
+    void reserve(int size);
+
+    // 为窗口 in[0, size) 建立前缀和，之后的 search() 基于该窗口（in 须保持有效）。
+    // 只需覆盖起点范围加最长周期下的前导码（reply_window_samples(link, 0, T)）
+    void load(const gr_complex* in, int size);
+
+    // 在起点 [0, span]、周期 T_nominal * (1 ± tolerance) 内搜索 CODE 的前导码
+    template <class CODE>
+    preamble_sync search(float span, float tolerance);
+
+    int size() const { return n_loaded; }
+};
+
+// in 上 [t0, t1) 的积分，零阶保持（与前缀和的插值一致）；调用者保证 0 <= t0 <= t1 < size - 1。
+// 同步之后的逐比特判决直接从输入积分，不需要为整个窗口建立前缀和
+gr_complex integrate_samples(const gr_complex* in, float t0, float t1);
+
+// in 上 [t0, t1) 内的能量 sum |x|^2，约束同 integrate_samples()
+float energy_samples(const gr_complex* in, float t0, float t1);
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_PREAMBLE_DETECTOR_H */
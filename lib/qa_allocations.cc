@@ -0,0 +1,91 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "qa_flowgraph.h"
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// 替换全局 operator new，统计整个进程（包括 GNU Radio 运行时与调度器线程）的堆分配次数
+static std::atomic<uint64_t> n_allocs(0);
+
+void* operator new(std::size_t n)
+{
+    n_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace gr {
+namespace reader {
+
+struct alloc_snapshot
+{
+    uint64_t allocs;
+    int slots, singles;
+};
+
+static alloc_snapshot snapshot(const qa_closed_loop& loop)
+{
+    return { n_allocs.load(), loop.slots(), loop.state->reader_stats.n_slots_single };
+}
+
+// 基准的前提：替换的 operator new 确实接管了进程里的堆分配（包括标准库容器）
+BOOST_AUTO_TEST_CASE(t_allocation_counter)
+{
+    uint64_t before = n_allocs.load();
+    std::vector<int> v;
+    v.reserve(16);
+    BOOST_CHECK_GE(n_allocs.load() - before, 1u);
+}
+
+// 计数包括调度器、标签表、日志与消息端口等运行时的分配，不能直接当作各 block 自身的分配次数；
+// 在真实调度器下核对之前只打印不判定，ctest 不运行。需要时用 --run_test=t_steady_state_allocations 单独跑
+BOOST_AUTO_TEST_CASE(t_steady_state_allocations, *boost::unit_test::disabled())
+{
+    const int warmup_slots = 50, measured_slots = 200;
+
+    std::printf("closed loop, 100 tags at 20 dB, 2 MS/s, heap allocations after %d slots of warm-up\n", warmup_slots);
+    std::printf("  profile      slots   windows   allocs   per slot   per window\n");
+    const struct { LINK_PROFILE profile; const char* name; } profiles[] = {
+        {LINK_BLF40_FM0, "BLF40 FM0"}, {LINK_BLF160_FM0, "BLF160 FM0"}, {LINK_BLF160_M2, "BLF160 M2"}};
+    for (const auto& p : profiles)
+    {
+        qa_closed_loop loop(2e6, 100, 20, p.profile);
+        loop.tb->start();
+
+        // 预热：第一批窗口会把各 block 的缓冲、标签值池与标签表填到稳态大小
+        bool warm = loop.wait_until([&] { return loop.slots() >= warmup_slots; }, 60);
+        alloc_snapshot a = snapshot(loop);
+        bool done = loop.wait_until([&] { return loop.slots() >= warmup_slots + measured_slots; }, 60);
+        alloc_snapshot b = snapshot(loop);
+
+        loop.tb->stop();
+        loop.tb->wait();
+        if (!warm || !done)
+        {
+            std::printf("  %-10s   closed loop did not reach %d slots within 60 s\n", p.name, warmup_slots + measured_slots);
+            continue;
+        }
+
+        // 每个 slot 有一个 RN16 窗口，发了 ACK 的 slot 再加一个 EPC 窗口
+        int slots = b.slots - a.slots;
+        int windows = slots + (b.singles - a.singles);
+        double allocs = (double) (b.allocs - a.allocs);
+        std::printf("  %-10s   %5d   %7d   %6.0f   %8.2f   %10.2f\n",
+                    p.name, slots, windows, allocs, allocs / slots, allocs / windows);
+    }
+}
+
+} // namespace reader
+} // namespace gr
@@ -0,0 +1,124 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "anti_collision.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+// 时隙 ALOHA 模型：每轮把未读标签均匀撒到 2^Q 个 slot，QueryRep 走到下一个 slot，
+// 只有一个标签的 slot 读成功。slot 的空口时间取自闭环仿真（2 MS/s，BLF 40 kHz）：
+// 空 slot 在 RN16 超时后结束，单标签和碰撞 slot 都会走完 RN16 + ACK + EPC 窗口。
+static const double T_EMPTY_SLOT = 1.51e-3;
+static const double T_REPLY_SLOT = 7.63e-3;
+static const double MAX_AIR_TIME = 600;   // 读不完时最多模拟的空口时间（s）
+
+struct aloha_result
+{
+    int n_read;
+    double air_time;
+    double reads_per_s() const { return n_read / air_time; }
+};
+
+static aloha_result run_aloha(ANTI_COLLISION policy, int n_tags, int initial_q, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    anti_collision::uptr ac = anti_collision::make(policy, initial_q);
+
+    std::vector<int> slot_count;
+    int left = n_tags, cursor = 0;
+    auto draw = [&](int q) {
+        slot_count.assign(1 << q, 0);
+        for (int i = 0; i < left; i++)
+            slot_count[rng() & ((1u << q) - 1)]++;
+        cursor = 0;
+    };
+    draw(initial_q);
+
+    double t = 0;
+    while (left > 0 && t < MAX_AIR_TIME)
+    {
+        // 碰撞的标签本轮不会再回复（slot 计数器减到 0x7FFF），只在下一条 Query/QueryAdjust 后重新抽 slot
+        int n = (cursor < (int) slot_count.size()) ? slot_count[cursor] : 0;
+        SLOT_OUTCOME o = (n == 0) ? SLOT_EMPTY : (n == 1) ? SLOT_SINGLE : SLOT_COLLISION;
+        t += (n == 0) ? T_EMPTY_SLOT : T_REPLY_SLOT;
+        if (n == 1)
+            left--;
+
+        SLOT_DECISION d = ac->slot_done(o);
+        if (d.next == SEND_QUERY_REP)
+            cursor++;
+        else
+            draw(d.q);
+    }
+    return { n_tags - left, t };
+}
+
+BOOST_AUTO_TEST_CASE(t_schoute_estimates_unread_backlog)
+{
+    // 一帧 16 个 slot：10 个成功、2 个碰撞、4 个空。剩余约 2.39 * 2 = 4.8 个标签，下一帧 Q = 2；
+    // 把已读的 10 个也算进去（n = s + 2.39 c）会得到 Q = 4
+    dfsa_schoute ac(4);
+    SLOT_DECISION d;
+    for (int i = 0; i < 16; i++)
+        d = ac.slot_done(i < 10 ? SLOT_SINGLE : i < 12 ? SLOT_COLLISION : SLOT_EMPTY);
+    BOOST_CHECK(d.new_round);
+    BOOST_CHECK_EQUAL(d.next, SEND_QUERY);
+    BOOST_CHECK_EQUAL(d.q, 2);
+
+    // 没有碰撞时所有标签都已读到，下一帧只留 1 个 slot
+    for (int i = 0; i < 4; i++)
+        d = ac.slot_done(i == 0 ? SLOT_SINGLE : SLOT_EMPTY);
+    BOOST_CHECK(d.new_round);
+    BOOST_CHECK_EQUAL(d.q, 0);
+}
+
+BOOST_AUTO_TEST_CASE(t_reads_per_second)
+{
+    const ANTI_COLLISION policies[] = {AC_FIXED_Q, AC_Q_ALGORITHM, AC_DFSA_SCHOUTE};
+    const int populations[] = {1, 10, 100, 1000};
+    const int runs = 20, initial_q = 4;
+
+    std::printf("reads/s, mean of %d runs, initial Q %d\n", runs, initial_q);
+    std::printf("  tags   fixed Q=4   Q-algorithm   DFSA Schoute\n");
+    for (int n_tags : populations)
+    {
+        double rate[3];
+        for (int p = 0; p < 3; p++)
+        {
+            double sum = 0;
+            int all_read = 0;
+            for (int r = 0; r < runs; r++)
+            {
+                aloha_result res = run_aloha(policies[p], n_tags, initial_q, r * 7919 + n_tags);
+                sum += res.reads_per_s();
+                all_read += (res.n_read == n_tags);
+            }
+            rate[p] = sum / runs;
+
+            // 动态策略在任何规模下都要把标签读完
+            if (policies[p] != AC_FIXED_Q)
+                BOOST_CHECK_EQUAL(all_read, runs);
+        }
+        std::printf("%6d   %9.1f   %11.1f   %12.1f\n", n_tags, rate[0], rate[1], rate[2]);
+
+        // 帧长跟上标签数之后，吞吐不应随规模塌掉（1/e 的 slot 效率约 60 reads/s）
+        if (n_tags >= 100)
+        {
+            BOOST_CHECK_GT(rate[1], 45.0);
+            BOOST_CHECK_GT(rate[2], 45.0);
+            BOOST_CHECK_GT(rate[1], 4 * rate[0]);
+        }
+    }
+}
+
+} // namespace reader
+} // namespace gr
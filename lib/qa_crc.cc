@@ -0,0 +1,204 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "crc.h"
+#include <gnuradio/reader/global_vars.h>
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+// 逐比特移位寄存器，作为查表实现的对照
+static uint16_t bitwise_crc16(const uint8_t* bytes, size_t n_bytes)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < 8 * n_bytes; i++)
+    {
+        int bit = (bytes[i / 8] >> (7 - i % 8)) & 1;
+        crc = ((crc >> 15) ^ bit) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return ~crc;
+}
+
+static uint8_t bitwise_crc5(const uint8_t* bytes, size_t n_bits)
+{
+    uint8_t crc = 0x09;
+    for (size_t i = 0; i < n_bits; i++)
+    {
+        int bit = (bytes[i / 8] >> (7 - i % 8)) & 1;
+        crc = (((crc >> 4) ^ bit) & 1) ? (uint8_t)(((crc << 1) ^ 0x09) & 0x1F) : (uint8_t)((crc << 1) & 0x1F);
+    }
+    return crc;
+}
+
+// 改动前 tag_decoder_impl::check_crc：'0'/'1' 字符数组，每次 malloc 一个字节缓冲
+// （原实现没有 free，这里补上以免测试本身漏内存）
+static int legacy_check_crc(const char* bits, int num_bits)
+{
+    int num_bytes = num_bits / 8;
+    unsigned char* data = (unsigned char*) malloc(num_bytes);
+    for (int i = 0; i < num_bytes; i++)
+    {
+        int mask = 0x80;
+        data[i] = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            if (bits[(i * 8) + j] == '1')
+                data[i] = data[i] | mask;
+            mask = mask >> 1;
+        }
+    }
+    unsigned short rcvd_crc = (data[num_bytes - 2] << 8) + data[num_bytes - 1];
+
+    unsigned short crc_16 = 0xFFFF;
+    for (int i = 0; i < num_bytes - 2; i++)
+    {
+        crc_16 ^= data[i] << 8;
+        for (int j = 0; j < 8; j++)
+        {
+            if (crc_16 & 0x8000)
+            {
+                crc_16 <<= 1;
+                crc_16 ^= 0x1021;
+            }
+            else
+                crc_16 <<= 1;
+        }
+    }
+    crc_16 = ~crc_16;
+    free(data);
+    return (rcvd_crc != crc_16) ? -1 : 1;
+}
+
+// 改动前 reader_impl::crc_append：17 个 Query 比特后追加 CRC-5（原实现按 crc[4] 与输入比特分四支，这里合并为反馈位的异或）
+static void legacy_crc_append(std::vector<float>& q)
+{
+    int crc[] = {1, 0, 0, 1, 0};
+    for (int i = 0; i < 17; i++)
+    {
+        int tmp[] = {0, 0, 0, 0, 0};
+        tmp[4] = crc[3];
+        int fb = crc[4] ^ (q[i] == 1);
+        tmp[0] = fb;
+        tmp[1] = crc[0];
+        tmp[2] = crc[1];
+        tmp[3] = crc[2] ^ fb;
+        memcpy(crc, tmp, 5 * sizeof(int));
+    }
+    for (int i = 4; i >= 0; i--)
+        q.push_back(crc[i]);
+}
+
+static std::vector<uint8_t> random_bytes(size_t n, std::mt19937& rng)
+{
+    std::vector<uint8_t> b(n);
+    for (uint8_t& x : b)
+        x = rng() & 0xFF;
+    return b;
+}
+
+BOOST_AUTO_TEST_CASE(t_crc16_matches_reference)
+{
+    // CRC-16/GENIBUS 的标准校验值（与 Gen2 CRC-16 的参数相同）
+    const char* check = "123456789";
+    BOOST_CHECK_EQUAL(crc16((const uint8_t*) check, 9), 0xD64E);
+
+    std::mt19937 rng(1);
+    for (size_t n = 0; n <= 64; n++)
+    {
+        for (int k = 0; k < 20; k++)
+        {
+            std::vector<uint8_t> msg = random_bytes(n, rng);
+            uint16_t crc = crc16(msg.data(), n);
+            BOOST_REQUIRE_EQUAL(crc, bitwise_crc16(msg.data(), n));
+
+            // 附加 CRC 后整条报文校验通过，任意翻转一个比特后失败
+            msg.push_back(crc >> 8);
+            msg.push_back(crc & 0xFF);
+            BOOST_REQUIRE(crc16_check(msg.data(), msg.size()));
+            size_t flip = rng() % (8 * msg.size());
+            msg[flip / 8] ^= 0x80 >> (flip % 8);
+            BOOST_REQUIRE(!crc16_check(msg.data(), msg.size()));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_crc5_matches_reference)
+{
+    std::mt19937 rng(2);
+    for (size_t n_bits = 1; n_bits <= 64; n_bits++)
+    {
+        for (int k = 0; k < 20; k++)
+        {
+            std::vector<uint8_t> msg = random_bytes((n_bits + 7) / 8, rng);
+            BOOST_REQUIRE_EQUAL(crc5(msg.data(), n_bits), bitwise_crc5(msg.data(), n_bits));
+        }
+    }
+
+    // 17 比特的 Query 前缀与旧的 crc_append 一致
+    for (int k = 0; k < 1000; k++)
+    {
+        uint32_t query = rng() & 0x1FFFF;
+        uint8_t packed[3] = { (uint8_t)(query >> 9), (uint8_t)(query >> 1), (uint8_t)(query << 7) };
+        std::vector<float> q;
+        for (int i = 16; i >= 0; i--)
+            q.push_back((query >> i) & 1);
+        legacy_crc_append(q);
+        int legacy = 0;
+        for (int i = 17; i < 22; i++)
+            legacy = (legacy << 1) | (int) q[i];
+        BOOST_REQUIRE_EQUAL(crc5(packed, 17), legacy);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_crc_ns_per_epc)
+{
+    // PC + EPC-96 + CRC-16 共 128 比特（EPC_BITS 再加 1 个 dummy 比特）
+    const int n_msgs = 256, n_bytes = (EPC_BITS - 1) / 8, repeat = 4000;
+    std::mt19937 rng(3);
+    std::vector<std::vector<uint8_t>> packed(n_msgs);
+    std::vector<std::vector<char>> chars(n_msgs);
+    for (int m = 0; m < n_msgs; m++)
+    {
+        packed[m] = random_bytes(n_bytes - 2, rng);
+        uint16_t crc = crc16(packed[m].data(), n_bytes - 2);
+        packed[m].push_back(crc >> 8);
+        packed[m].push_back(crc & 0xFF);
+        for (int i = 0; i < 8 * n_bytes; i++)
+            chars[m].push_back(((packed[m][i / 8] >> (7 - i % 8)) & 1) ? '1' : '0');
+    }
+
+    int n_ok_legacy = 0, n_ok = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+        for (int m = 0; m < n_msgs; m++)
+            n_ok_legacy += legacy_check_crc(chars[m].data(), 8 * n_bytes) == 1;
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+        for (int m = 0; m < n_msgs; m++)
+            n_ok += crc16_check(packed[m].data(), n_bytes);
+    auto t2 = std::chrono::steady_clock::now();
+
+    double n = (double) n_msgs * repeat;
+    double ns_legacy = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+    double ns_table  = std::chrono::duration<double, std::nano>(t2 - t1).count() / n;
+    std::printf("CRC-16 check of a 128-bit EPC reply: bitwise + malloc %.1f ns, slice-by-4 %.1f ns\n",
+                ns_legacy, ns_table);
+
+    BOOST_CHECK_EQUAL(n_ok_legacy, n_msgs * repeat);
+    BOOST_CHECK_EQUAL(n_ok, n_msgs * repeat);
+    BOOST_CHECK_LT(ns_table, ns_legacy);
+}
+
+} // namespace reader
+} // namespace gr
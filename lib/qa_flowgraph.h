@@ -0,0 +1,164 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_QA_FLOWGRAPH_H
+#define INCLUDED_READER_QA_FLOWGRAPH_H
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/reader/gate.h>
+#include <gnuradio/reader/reader.h>
+#include <gnuradio/reader/tag_decoder.h>
+#include <gnuradio/reader/tag_emulator.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/top_block.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+/*!
+ * \brief QA 用的复数源：把 data 重放 repeat 次后结束；tags 中的标签按偏移打在对应的输出样点上
+ * （偏移以第一遍重放为准，之后每遍重复）。
+ */
+class qa_vector_source : public gr::sync_block
+{
+public:
+    typedef std::shared_ptr<qa_vector_source> sptr;
+
+    static sptr make(const std::vector<gr_complex>& data, int repeat = 1, const std::vector<gr::tag_t>& tags = {})
+    {
+        return gnuradio::make_block_sptr<qa_vector_source>(data, repeat, tags);
+    }
+
+    qa_vector_source(const std::vector<gr_complex>& data, int repeat, const std::vector<gr::tag_t>& tags)
+        : gr::sync_block("qa_vector_source",
+                         gr::io_signature::make(0, 0, 0),
+                         gr::io_signature::make(1, 1, sizeof(gr_complex))),
+          d_data(data), d_tags(tags), d_total((uint64_t) data.size() * repeat)
+    {
+        std::sort(d_tags.begin(), d_tags.end(),
+                  [](const gr::tag_t& a, const gr::tag_t& b) { return a.offset < b.offset; });
+    }
+
+    int work(int noutput_items,
+             gr_vector_const_void_star& input_items,
+             gr_vector_void_star& output_items) override
+    {
+        auto out = static_cast<gr_complex*>(output_items[0]);
+        uint64_t pos = nitems_written(0);
+        if (pos >= d_total)
+            return WORK_DONE;
+
+        // 每次最多写到本遍重放的末尾
+        uint64_t in_pass = pos % d_data.size();
+        int n = (int) std::min<uint64_t>(noutput_items, std::min<uint64_t>(d_total - pos, d_data.size() - in_pass));
+        std::memcpy(out, d_data.data() + in_pass, n * sizeof(gr_complex));
+        for (const gr::tag_t& t : d_tags)
+            if (t.offset >= in_pass && t.offset < in_pass + n)
+                add_item_tag(0, pos - in_pass + t.offset, t.key, t.value);
+        return n;
+    }
+
+private:
+    std::vector<gr_complex> d_data;
+    std::vector<gr::tag_t> d_tags;
+    uint64_t d_total;
+};
+
+//! QA 用的复数接收端：丢弃输入，只计数；接在 gate 之后时记下每个突发 SOB 描述符里的 RX 样点序号
+class qa_null_sink : public gr::sync_block
+{
+public:
+    typedef std::shared_ptr<qa_null_sink> sptr;
+
+    static sptr make() { return gnuradio::make_block_sptr<qa_null_sink>(); }
+
+    qa_null_sink()
+        : gr::sync_block("qa_null_sink",
+                         gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                         gr::io_signature::make(0, 0, 0)),
+          n_items(0), d_sob_key(pmt::mp(BURST_SOB_KEY))
+    {
+    }
+
+    int work(int noutput_items,
+             gr_vector_const_void_star& input_items,
+             gr_vector_void_star& output_items) override
+    {
+        get_tags_in_range(d_tags, 0, nitems_read(0), nitems_read(0) + noutput_items);
+        for (const gr::tag_t& t : d_tags)
+        {
+            size_t len;
+            if (pmt::eq(t.key, d_sob_key))
+                sob_rx_samples.push_back(pmt::u64vector_elements(t.value, len)[SOB_RX_SAMPLE]);
+        }
+        n_items += noutput_items;
+        return noutput_items;
+    }
+
+    uint64_t n_items;
+    std::vector<uint64_t> sob_rx_samples;
+
+private:
+    pmt::pmt_t d_sob_key;
+    std::vector<gr::tag_t> d_tags;
+};
+
+/*!
+ * \brief QA 用的闭环：reader -> tag_emulator -> gate -> tag_decoder，共用一个 READER_STATE。
+ *
+ * tag_emulator 不限速，环路以快于实时的速度运行。盘存结束（TERMINATED）后 gate 不再放行窗口，
+ * reader 停在 IDLE 等待，flowgraph 要由调用者 stop()/wait()。
+ */
+struct qa_closed_loop
+{
+    READER_STATE::sptr state;
+    gr::top_block_sptr tb;
+    reader::sptr rd;
+    tag_emulator::sptr tags;
+    gate::sptr gt;
+    tag_decoder::sptr decoder;
+
+    qa_closed_loop(float sample_rate, int n_tags, float snr_db, LINK_PROFILE profile = LINK_BLF40_FM0)
+        : state(READER_STATE::make()), tb(gr::make_top_block("qa_closed_loop"))
+    {
+        rd = reader::make(state, sample_rate, sample_rate, 0, {}, {}, profile);
+        tags = tag_emulator::make(sample_rate, n_tags, 0, snr_db);
+        gt = gate::make(state, sample_rate);
+        decoder = tag_decoder::make(state, sample_rate);
+        tb->connect(rd, 0, tags, 0);
+        tb->connect(tags, 0, gt, 0);
+        tb->connect(gt, 0, decoder, 0);
+    }
+
+    //! 已发出的 Query 类命令数，即已开始的 slot 数
+    int slots() const { return state->reader_stats.n_queries_sent.load(); }
+    bool terminated() const { return state->status.load() == TERMINATED; }
+
+    //! 每 1 ms 检查一次 done()，直到成立或超过 timeout_s 秒（墙钟）；轮询本身不分配内存
+    template <class DONE>
+    bool wait_until(DONE done, double timeout_s)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout_s);
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+};
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_QA_FLOWGRAPH_H */
@@ -0,0 +1,157 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "qa_flowgraph.h"
+#include <gnuradio/reader/gate.h>
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace gr {
+namespace reader {
+
+// 载波（含泄漏）上每 period_us 一条命令：delimiter 加 22 个 PIE 符号（data-0 / data-1 交替，低电平 PW），
+// 其余时间为 CW；加复高斯噪声。返回的流长度是整数个周期，可以首尾相接地重放
+static std::vector<gr_complex> make_rx_stream(float fs, int n_periods, float period_us)
+{
+    const LINK_PARAMS link = link_params(LINK_BLF40_FM0);
+    const gr_complex leak(0.6f, 0.2f);
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0, 0.01f);
+
+    std::vector<gr_complex> x;
+    auto put = [&](float level, float us) {
+        int n = std::lround(us * fs / 1e6f);
+        for (int i = 0; i < n; i++)
+            x.push_back(leak * level + gr_complex(noise(rng), noise(rng)));
+    };
+    for (int p = 0; p < n_periods; p++)
+    {
+        size_t start = x.size();
+        put(1, 1000);
+        put(0, 12.5f);
+        for (int s = 0; s < 22; s++)
+        {
+            float len = (s % 2) ? 2 * link.tari_d : link.tari_d;
+            put(1, len - link.pw_d());
+            put(0, link.pw_d());
+        }
+        put(1, period_us - (x.size() - start) / fs * 1e6f);
+    }
+    return x;
+}
+
+// 改动前 gate 逐样点的包络、门限与 DC 跟踪循环（门关闭时的路径），作为吞吐与检测位置的对照。
+// 检测到命令时不开门，只记下判定命令结束的样点（旧 gate 把它作为窗口的第一个样点输出）
+struct scalar_gate_reference
+{
+    int win_length, dc_length, n_samples_T1, n_samples_PW;
+    std::vector<float> win_samples;
+    std::vector<gr_complex> dc_samples;
+    int win_index = 0, dc_index = 0, n_samples = 0, num_pulses = 0;
+    bool pos_edge = false;
+    float avg_ampl = 0;
+    gr_complex dc_est = 0;
+    uint64_t n_consumed = 0;
+    std::vector<uint64_t> cmd_ends;
+
+    scalar_gate_reference(float fs)
+    {
+        const LINK_PARAMS link = link_params(LINK_BLF40_FM0);
+        win_length   = WIN_SIZE_D * (fs / 1e6);
+        dc_length    = DC_SIZE_D * (fs / 1e6);
+        n_samples_T1 = link.t1_d * (fs / 1e6);
+        n_samples_PW = link.pw_d() * (fs / 1e6);
+        win_samples.assign(win_length, 0);
+        dc_samples.assign(dc_length, 0);
+    }
+
+    void run(const gr_complex* in, int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            float sample_ampl = std::abs(in[i]);
+            avg_ampl = avg_ampl + (sample_ampl - win_samples[win_index]) / win_length;
+            win_samples[win_index] = sample_ampl;
+            win_index = (win_index + 1) % win_length;
+            float sample_thresh = avg_ampl * THRESH_FRACTION;
+
+            dc_est = dc_est + (in[i] - dc_samples[dc_index]) / std::complex<float>(dc_length, 0);
+            dc_samples[dc_index] = in[i];
+            dc_index = (dc_index + 1) % dc_length;
+
+            n_samples++;
+            if (sample_ampl < sample_thresh && pos_edge)
+            {
+                n_samples = 0;
+                pos_edge = false;
+            }
+            else if (sample_ampl > sample_thresh && !pos_edge)
+            {
+                pos_edge = true;
+                if (n_samples > n_samples_PW / 2) num_pulses++;
+                else num_pulses = 0;
+                n_samples = 0;
+            }
+
+            if (n_samples > n_samples_T1 && pos_edge && num_pulses > NUM_PULSES_COMMAND)
+            {
+                cmd_ends.push_back(n_consumed + i);
+                num_pulses = 0;
+                n_samples = 0;
+            }
+        }
+        n_consumed += n;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(t_gate_throughput)
+{
+    const int n_periods = 200, repeat = 20;
+    const float period_us = 2500;
+
+    std::printf("gate, one early-closed window per command (Msamples/s)\n");
+    std::printf("  rate      scalar loop   gate block\n");
+    for (float fs : {2e6f, 10e6f})
+    {
+        std::vector<gr_complex> rx = make_rx_stream(fs, n_periods, period_us);
+        double n_total = (double) rx.size() * repeat;
+
+        scalar_gate_reference ref(fs);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++)
+            ref.run(rx.data(), rx.size());
+        double t_ref = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        BOOST_CHECK_EQUAL(ref.cmd_ends.size(), n_periods * repeat);
+
+        // 整个 block 在调度器下跑（VOLK 幅度 + 块内滑窗均值 + 门限跨越扫描）。每条命令之后门打开一次，
+        // 流里没有标签回复，窗口在前导码检测段结束处提前关门
+        gr::top_block_sptr tb = gr::make_top_block("qa_gate");
+        qa_vector_source::sptr src = qa_vector_source::make(rx, repeat);
+        gate::sptr gt = gate::make(READER_STATE::make(), fs);
+        qa_null_sink::sptr sink = qa_null_sink::make();
+        tb->connect(src, 0, gt, 0);
+        tb->connect(gt, 0, sink, 0);
+        t0 = std::chrono::steady_clock::now();
+        tb->run();
+        double t_gate = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        const LINK_PARAMS link = link_params(LINK_BLF40_FM0);
+        uint64_t n_detect = reply_window_samples(link, 0, link.tag_bit_d() * (fs / pow(10,6)));
+        BOOST_CHECK_EQUAL(sink->n_items, n_detect * n_periods * repeat);
+
+        // 块内核与逐样点循环在同一个样点上判定命令结束：每个窗口 SOB 的 RX 序号与对照的开门位置逐一相同
+        BOOST_CHECK_EQUAL_COLLECTIONS(sink->sob_rx_samples.begin(), sink->sob_rx_samples.end(),
+                                      ref.cmd_ends.begin(), ref.cmd_ends.end());
+
+        std::printf("  %4.0f MS/s  %9.1f   %10.1f\n", fs / 1e6, n_total / t_ref / 1e6, n_total / t_gate / 1e6);
+    }
+}
+
+} // namespace reader
+} // namespace gr
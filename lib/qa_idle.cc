@@ -0,0 +1,105 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "qa_flowgraph.h"
+#include <boost/test/unit_test.hpp>
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+// 进程的 CPU 时间（用户 + 内核，s）
+static double process_cpu_s()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static double wall_s()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BOOST_AUTO_TEST_CASE(t_reader_blocks_while_idle)
+{
+    // 不经过调度器，直接调用 reader 的 general_work：IDLE 时每次调用都要在 wait_gen2_logic_status()
+    // 里等满 IDLE_WAIT_MS 才返回 0（空转时立即返回），只用下界判断，机器繁忙时也不会误报
+    READER_STATE::sptr state = READER_STATE::make();
+    reader::sptr rd = reader::make(state, 2e6, 2e6, 0, {}, {}, LINK_BLF40_FM0);
+    state->gen2_logic_status.store(IDLE);
+    state->gate_status.store(GATE_CLOSED);
+
+    std::vector<float> out(1 << 16);
+    gr_vector_int ninput_items;
+    gr_vector_const_void_star input_items;
+    gr_vector_void_star output_items(1, out.data());
+
+    const int n_calls = 5;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int c = 0; c < n_calls; c++)
+        BOOST_REQUIRE_EQUAL(rd->general_work(out.size(), ninput_items, input_items, output_items), 0);
+    double waited_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    BOOST_CHECK_GE(waited_ms, n_calls * IDLE_WAIT_MS);
+
+    // decoder 在等待期间发布决定：reader 被唤醒，发出 QueryRep 并请 gate 找 RN16，自己回到 IDLE
+    std::thread decoder([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_WAIT_MS / 5));
+        state->set_gen2_logic_status(SEND_QUERY_REP);
+    });
+    int n = rd->general_work(out.size(), ninput_items, input_items, output_items);
+    decoder.join();
+    BOOST_CHECK_GT(n, 0);
+    BOOST_CHECK_EQUAL(state->gen2_logic_status.load(), IDLE);
+    BOOST_CHECK_EQUAL(state->gate_status.load(), GATE_SEEK_RN16);
+}
+
+// 整个闭环在调度器下的 CPU 占用与 RN16 -> ACK 间隔。结果取决于机器负载与调度器的缓冲深度，
+// 只打印不判定，ctest 不运行；需要时用 --run_test=t_idle_cpu_and_t2_gap 单独跑
+BOOST_AUTO_TEST_CASE(t_idle_cpu_and_t2_gap, *boost::unit_test::disabled())
+{
+    std::printf("closed loop, 100 tags at 20 dB, 2 MS/s\n");
+    std::printf("  profile      busy cores   idle cores   RN16->ACK gap p50 / p99 / max (us)   T2 max\n");
+    const struct { LINK_PROFILE profile; const char* name; } profiles[] = {
+        {LINK_BLF40_FM0, "BLF40 FM0"}, {LINK_BLF160_FM0, "BLF160 FM0"}, {LINK_BLF160_M2, "BLF160 M2"}};
+    for (const auto& p : profiles)
+    {
+        LINK_PROFILE profile = p.profile;
+        qa_closed_loop loop(2e6, 100, 20, profile);
+
+        // 盘存期间：环路是串行的，任一时刻只有一个 block 有活干，其余都在等
+        double cpu0 = process_cpu_s(), t0 = wall_s();
+        loop.tb->start();
+        bool done = loop.wait_until([&] { return loop.terminated(); }, 120);
+        double busy_cores = (process_cpu_s() - cpu0) / (wall_s() - t0);
+
+        // 盘存结束后 gate 不再放行窗口，reader 停在 IDLE。先等环路里剩下的样点走完，再量 1 s 的 CPU
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        cpu0 = process_cpu_s();
+        t0 = wall_s();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        double idle_cores = (process_cpu_s() - cpu0) / (wall_s() - t0);
+
+        loop.tb->stop();
+        loop.tb->wait();
+        if (!done)
+            std::printf("  %-10s   inventory did not finish within 120 s\n", p.name);
+
+        // RN16 结束到 ACK 开始（样点时间，含 TX/RX 缓冲），与 T2 <= 20 Tpri 对照
+        LATENCY_SUMMARY gap = loop.rd->turnaround_latency(TURNAROUND_RN16_ACK, LAT_AIR);
+        double t2_max = 20 / link_params(profile).blf() * 1e6;
+        std::printf("  %-10s   %10.2f   %10.3f   %9.1f / %6.1f / %6.1f            %6.1f\n",
+                    p.name, busy_cores, idle_cores, gap.p50_us, gap.p99_us, gap.max_us, t2_max);
+    }
+}
+
+} // namespace reader
+} // namespace gr
@@ -0,0 +1,231 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "preamble_detector.h"
+#include "qa_signal.h"
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace gr {
+namespace reader {
+
+// 改动前 tag_decoder_impl::tag_sync 的前导码搜索：起点 [0, 1.5 bit) 逐样点，
+// 每个起点在码片起点（取整）上做 12 点相关。返回相关最大的整数起点
+static int integer_tag_sync(const gr_complex* in, float n_samples_TAG_BIT)
+{
+    int max_index = 0;
+    float max = 0;
+    for (int i = 0; i < 1.5 * n_samples_TAG_BIT; i++)
+    {
+        gr_complex corr2(0, 0);
+        for (int j = 0; j < 2 * TAG_PREAMBLE_BITS; j++)
+            corr2 = corr2 + in[(int) (i + j * n_samples_TAG_BIT / 2)] * gr_complex(TAG_PREAMBLE[j] ? 1 : -1, 0);
+        float corr = std::norm(corr2);
+        if (corr > max)
+        {
+            max = corr;
+            max_index = i;
+        }
+    }
+    return max_index;
+}
+
+// gate 输出的一个 RN16 窗口（已减去 DC）：起点 start 的 FM0 回复，SNR 为 snr_db
+static const gr_complex H_TAG(0.03f, -0.04f);
+
+static std::vector<gr_complex> make_rn16(float T, float start, float snr_db, std::mt19937& rng)
+{
+    // RN16_BITS 含 dummy 1，qa_reply_chips() 会补上
+    std::vector<int> bits(RN16_BITS - 1);
+    for (int& b : bits)
+        b = rng() & 1;
+    std::vector<gr_complex> x(reply_window_samples(link_params(LINK_BLF40_FM0), RN16_BITS, T));
+    qa_add_reply(x, qa_reply_chips<fm0>(bits), start, T / fm0::CHIPS, H_TAG);
+    qa_add_noise(x, H_TAG, snr_db, rng);
+    return x;
+}
+
+// 起点误差的均方根与耗时
+struct sync_score
+{
+    double sq_err = 0, seconds = 0;
+    int n = 0, n_detected = 0;
+    void add(double err) { sq_err += err * err; n++; }
+    double rms() const { return std::sqrt(sq_err / n); }
+    double us_per_search() const { return seconds / n * 1e6; }
+};
+
+BOOST_AUTO_TEST_CASE(t_preamble_cost_and_accuracy)
+{
+    const int trials = 2000;
+    const LINK_PARAMS link = link_params(LINK_BLF40_FM0);
+
+    std::printf("FM0 preamble sync, BLF 40 kHz, start uniform in [0, 1.25 bit), %d trials\n", trials);
+    std::printf("  rate      SNR    integer search: rms err  us/search   matched filter: rms err  us/search  detected\n");
+    for (float fs : {2e6f, 10e6f})
+    {
+        float T = link.tag_bit_d() * fs / 1e6f;
+        // 与 gate 相同，只为起点范围加前导码的一段建立前缀和
+        const int n_detect = reply_window_samples(link, 0, T);
+        preamble_detector detector(T);
+        detector.reserve(n_detect);
+
+        for (float snr_db : {3.0f, 10.0f, 20.0f})
+        {
+            std::mt19937 rng(1);
+            std::uniform_real_distribution<float> start_dist(0, 1.25f * T);
+            sync_score old_score, new_score;
+            for (int k = 0; k < trials; k++)
+            {
+                float start = start_dist(rng);
+                std::vector<gr_complex> x = make_rn16(T, start, snr_db, rng);
+
+                auto t0 = std::chrono::steady_clock::now();
+                int old_start = integer_tag_sync(x.data(), T);
+                auto t1 = std::chrono::steady_clock::now();
+                detector.load(x.data(), n_detect);
+                preamble_sync sync = detector.search<fm0>(PREAMBLE_SEARCH_BITS * T, BLF_TOLERANCE);
+                auto t2 = std::chrono::steady_clock::now();
+
+                old_score.seconds += std::chrono::duration<double>(t1 - t0).count();
+                new_score.seconds += std::chrono::duration<double>(t2 - t1).count();
+                old_score.add(old_start - start);
+                new_score.add(sync.start - start);
+                new_score.n_detected += preamble_detected(sync);
+            }
+            std::printf("  %4.0f MS/s  %4.0f dB   %22.2f  %9.2f   %22.2f  %9.2f  %7.1f%%\n",
+                        fs / 1e6, snr_db, old_score.rms(), old_score.us_per_search(),
+                        new_score.rms(), new_score.us_per_search(), 100.0 * new_score.n_detected / trials);
+
+            // 整数搜索只在码片起点上取样，相关峰是半个码片宽的平台，噪声决定落在平台的哪一点；
+            // 匹配滤波积分整个码片，再做抛物线插值。10 dB 起起点误差要在 1/4 样点以内
+            if (snr_db >= 10)
+            {
+                BOOST_CHECK_LT(new_score.rms(), 0.25);
+                BOOST_CHECK_LT(new_score.rms(), old_score.rms());
+                BOOST_CHECK_EQUAL(new_score.n_detected, trials);
+            }
+
+            // 整数搜索的代价随采样率线性增长；粗搜索的网格只取决于码片数，10 MS/s 时要比它便宜
+            if (fs >= 10e6f)
+                BOOST_CHECK_LT(new_score.us_per_search(), old_score.us_per_search());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_preamble_wide_window_and_false_alarm)
+{
+    const float fs = 2e6f;
+    const LINK_PARAMS link = link_params(LINK_BLF40_FM0);
+    const float T = link.tag_bit_d() * fs / 1e6f;
+    const int trials = 500;
+    preamble_detector detector(T);
+    std::mt19937 rng(2);
+
+    // T1 抖动到 2.5 bit 时仍在 PREAMBLE_SEARCH_BITS 的搜索范围内（整数搜索只看 1.5 bit）
+    int n_found = 0;
+    for (int k = 0; k < trials; k++)
+    {
+        float start = std::uniform_real_distribution<float>(1.5f * T, 2.5f * T)(rng);
+        std::vector<gr_complex> x = make_rn16(T, start, 10, rng);
+        detector.load(x.data(), x.size());
+        preamble_sync sync = detector.search<fm0>(PREAMBLE_SEARCH_BITS * T, BLF_TOLERANCE);
+        n_found += preamble_detected(sync) && std::abs(sync.start - start) < 1;
+    }
+    BOOST_CHECK_EQUAL(n_found, trials);
+
+    // 只有载波和噪声的窗口（空 slot）不应判为检测到前导码
+    int n_false = 0;
+    for (int k = 0; k < trials; k++)
+    {
+        std::vector<gr_complex> x(reply_window_samples(link, RN16_BITS, T));
+        qa_add_noise(x, H_TAG, 10, rng);
+        detector.load(x.data(), x.size());
+        n_false += preamble_detected(detector.search<fm0>(PREAMBLE_SEARCH_BITS * T, BLF_TOLERANCE));
+    }
+    std::printf("T1 up to 2.5 bit: %d/%d found; noise only: %d/%d false alarms\n", n_found, trials, n_false, trials);
+    BOOST_CHECK_LE(n_false, trials / 100);
+}
+
+// 在 link 的窗口里搜索 CODE 的前导码：标签 BLF 偏差 blf_error，回复起点在 pilot 之前 [0.25, 1.25] bit。
+// 返回每次搜索的耗时，起点误差与周期误差计入 score
+template <class CODE>
+static void search_code(const LINK_PARAMS& link, float fs, float blf_error, float snr_db, int trials,
+                        sync_score& start_score, sync_score& period_score)
+{
+    const float T = link.tag_bit_d() * fs / 1e6f;
+    const float T_tag = T / (1 + blf_error);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> uni(0, 1);
+    const int n_detect = reply_window_samples(link, 0, T);
+    preamble_detector detector(T);
+    detector.reserve(n_detect);
+
+    for (int k = 0; k < trials; k++)
+    {
+        std::vector<int> bits(RN16_BITS - 1);
+        for (int& b : bits)
+            b = rng() & 1;
+        float start = (0.25f + uni(rng)) * T;
+        gr_complex h = H_TAG * std::polar(1.0f, 6.2832f * uni(rng));
+        std::vector<gr_complex> x(reply_window_samples(link, RN16_BITS, T));
+        qa_add_reply(x, qa_reply_chips<CODE>(bits, link.trext), start, T_tag / CODE::CHIPS, h);
+        qa_add_noise(x, h, snr_db, rng);
+
+        // 与 tag_decoder 相同：TRext 时起点搜索范围后移 pilot 长度
+        auto t0 = std::chrono::steady_clock::now();
+        detector.load(x.data(), n_detect);
+        preamble_sync sync = detector.search<CODE>((PREAMBLE_SEARCH_BITS + link.pilot_bits()) * T, BLF_TOLERANCE);
+        start_score.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        start_score.add(sync.start - (start + link.pilot_bits() * T_tag));
+        start_score.n_detected += preamble_detected(sync);
+        period_score.add(sync.T / T_tag - 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_miller_vs_fm0_search_time)
+{
+    const int trials = 300;
+    const float blf_error = 0.05f, snr_db = 10;
+    const struct { LINK_PROFILE profile; const char* name; } profiles[] = {
+        {LINK_BLF40_FM0, "BLF40 FM0"}, {LINK_BLF160_M2, "BLF160 M2"},
+        {LINK_BLF256_M4, "BLF256 M4"}, {LINK_BLF320_M8, "BLF320 M8"}};
+
+    std::printf("preamble search per RN16 window, %.0f%% BLF error, %.0f dB, %d trials\n", blf_error * 100, snr_db, trials);
+    std::printf("  rate      profile      us/search   T2 (us)   start rms (samples)   period rms   detected\n");
+    for (float fs : {2e6f, 4e6f})
+    {
+        for (const auto& p : profiles)
+        {
+            LINK_PARAMS link = link_params(p.profile);
+            sync_score start_score, period_score;
+            switch (link.m)
+            {
+            case 0:  search_code<fm0>(link, fs, blf_error, snr_db, trials, start_score, period_score);     break;
+            case 1:  search_code<miller2>(link, fs, blf_error, snr_db, trials, start_score, period_score); break;
+            case 2:  search_code<miller4>(link, fs, blf_error, snr_db, trials, start_score, period_score); break;
+            default: search_code<miller8>(link, fs, blf_error, snr_db, trials, start_score, period_score); break;
+            }
+            std::printf("  %4.0f MS/s  %-10s   %9.1f   %7.0f   %19.2f   %9.2f%%   %7.1f%%\n", fs / 1e6, p.name,
+                        start_score.us_per_search(), link.t2_d, start_score.rms(), 100 * period_score.rms(),
+                        100.0 * start_score.n_detected / trials);
+
+            // 每种线路码都要在 BLF 偏差下锁定起点与周期
+            BOOST_CHECK_EQUAL(start_score.n_detected, trials);
+            BOOST_CHECK_LT(start_score.rms(), 1.0);
+            BOOST_CHECK_LT(period_score.rms(), 0.01);
+            // gate 在窗口里做一次搜索，要在回复结束到下一条命令的 T2 之内完成
+            BOOST_CHECK_LT(start_score.us_per_search(), link.t2_d);
+        }
+    }
+}
+
+} // namespace reader
+} // namespace gr
@@ -0,0 +1,80 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_QA_SIGNAL_H
+#define INCLUDED_READER_QA_SIGNAL_H
+
+#include "line_code.h"
+#include <gnuradio/gr_complex.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+/*
+ * QA 用的标签回复波形，码片序列与 tag_emulator 相同：
+ * （TRext 时的）pilot、前导码、数据比特、dummy 1，每个码片为 ±1。
+ */
+template <class CODE>
+std::vector<float> qa_reply_chips(const std::vector<int>& bits, bool trext = false)
+{
+    std::vector<float> chips;
+    auto push_half = [&chips](int level, int first_chip) {
+        for (int k = 0; k < CODE::SUBCARRIER; k++)
+            chips.push_back(level * CODE::subcarrier(first_chip + k));
+    };
+    auto push_bit = [&push_half](int bit, BASEBAND_STATE& s) {
+        int a, c;
+        CODE::encode(bit, s, a, c);
+        push_half(a, 0);
+        push_half(c, CODE::SUBCARRIER);
+    };
+
+    if (trext)
+    {
+        BASEBAND_STATE s = CODE::pilot_state();
+        for (int i = 0; i < TREXT_PILOT_BITS; i++)
+            push_bit(0, s);
+    }
+    const auto& preamble = CODE::preamble_halves();
+    for (int k = 0; k < 2 * CODE::PREAMBLE_BITS; k++)
+        push_half(preamble[k], (k % 2) * CODE::SUBCARRIER);
+    BASEBAND_STATE s = CODE::preamble_end();
+    for (int b : bits)
+        push_bit(b, s);
+    push_bit(1, s);
+    return chips;
+}
+
+// 把码片叠加到 x 上，起点 start 可以是分数样点。样点 n 取 [n, n + 1) 内码片电平的平均
+// （积分-清零采样，即 preamble_detector 的零阶保持模型），分数起点因此在样点值上可见
+inline void qa_add_reply(std::vector<gr_complex>& x, const std::vector<float>& chips, float start, float chip, gr_complex h)
+{
+    // 码片 k 覆盖 [a, b)，按与每个样点区间的重叠长度累加
+    for (size_t k = 0; k < chips.size(); k++)
+    {
+        double a = start + k * (double) chip, b = a + chip;
+        for (long n = std::max(0L, (long) std::floor(a)); n < (long) x.size() && n < b; n++)
+            x[n] += h * chips[k] * (float) (std::min<double>(n + 1, b) - std::max<double>(n, a));
+    }
+}
+
+// 加复高斯噪声，SNR 定义与 tag_emulator 相同：|h|^2 与每样点噪声功率之比
+inline void qa_add_noise(std::vector<gr_complex>& x, gr_complex h, float snr_db, std::mt19937& rng)
+{
+    std::normal_distribution<float> gauss(0, std::abs(h) / std::sqrt(2.0f) * std::pow(10.0f, -snr_db / 20));
+    for (gr_complex& v : x)
+        v += gr_complex(gauss(rng), gauss(rng));
+}
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_QA_SIGNAL_H */
@@ -0,0 +1,237 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "crc.h"
+#include "preamble_detector.h"
+#include "qa_flowgraph.h"
+#include "qa_signal.h"
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdio>
+
+namespace gr {
+namespace reader {
+
+/*
+ * gate 输出的突发流：每个窗口第一个样点带 SOB / DC 标签，最后一个样点带 EOB 标签，
+ * 样点已减去 DC。关门时刻记为 0，decoder 不统计这些窗口的延迟。
+ * 给出 sync 时像 gate 一样把前导码同步结果写进 SOB，否则由 decoder 自己搜索。
+ */
+struct qa_burst_stream
+{
+    std::vector<gr_complex> samples;
+    std::vector<gr::tag_t> tags;
+    uint64_t seq = 0;
+
+    void add(DECODER_STATUS type, LINK_PROFILE profile, const std::vector<gr_complex>& window,
+             const preamble_sync* sync = nullptr)
+    {
+        uint64_t start = samples.size();
+        size_t len;
+        pmt::pmt_t sob = pmt::make_u64vector(N_SOB_FIELDS, 0);
+        uint64_t* f = pmt::u64vector_writable_elements(sob, len);
+        f[SOB_SEQ] = seq++;
+        f[SOB_TYPE] = type;
+        f[SOB_LINK] = profile;
+        f[SOB_RX_SAMPLE] = start;
+        if (sync)
+        {
+            f[SOB_SYNC] = 1;
+            f[SOB_SYNC_START] = float_field(sync->start);
+            f[SOB_SYNC_T] = float_field(sync->T);
+            f[SOB_SYNC_QUALITY] = float_field(sync->quality);
+            f[SOB_SYNC_H_RE] = float_field(sync->h.real());
+            f[SOB_SYNC_H_IM] = float_field(sync->h.imag());
+        }
+        pmt::pmt_t eob = pmt::make_u64vector(N_EOB_FIELDS, 0);
+        pmt::u64vector_writable_elements(eob, len)[EOB_LENGTH] = window.size();
+
+        tags.push_back({ start, pmt::mp(BURST_SOB_KEY), sob, pmt::PMT_F });
+        tags.push_back({ start, pmt::mp(BURST_DC_KEY), pmt::make_c32vector(1, gr_complex(0, 0)), pmt::PMT_F });
+        tags.push_back({ start + window.size() - 1, pmt::mp(BURST_EOB_KEY), eob, pmt::PMT_F });
+        samples.insert(samples.end(), window.begin(), window.end());
+    }
+};
+
+// 把突发流送进一个新的 tag_decoder，返回墙钟耗时（s）；统计留在 state 里
+static double run_decoder(const qa_burst_stream& stream, READER_STATE::sptr state, float fs, DECODER_MODE mode)
+{
+    gr::top_block_sptr tb = gr::make_top_block("qa_tag_decoder");
+    qa_vector_source::sptr src = qa_vector_source::make(stream.samples, 1, stream.tags);
+    tag_decoder::sptr decoder = tag_decoder::make(state, fs, mode);
+    tb->connect(src, 0, decoder, 0);
+    auto t0 = std::chrono::steady_clock::now();
+    tb->run();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// PC + EPC-96 + CRC-16（MSB first 的比特序列，不含 dummy 1）
+static std::vector<int> make_epc(std::mt19937& rng)
+{
+    const int n_bytes = (EPC_BITS - 1) / 8;
+    uint8_t bytes[n_bytes];
+    for (int i = 0; i < n_bytes - 2; i++)
+        bytes[i] = rng() & 0xFF;
+    uint16_t crc = crc16(bytes, n_bytes - 2);
+    bytes[n_bytes - 2] = crc >> 8;
+    bytes[n_bytes - 1] = crc & 0xFF;
+
+    std::vector<int> bits(EPC_BITS - 1);
+    for (int i = 0; i < EPC_BITS - 1; i++)
+        bits[i] = (bytes[i / 8] >> (7 - i % 8)) & 1;
+    return bits;
+}
+
+// 一个 EPC 窗口：随机相位，起点在 [0.25, 1.25] bit
+static std::vector<gr_complex> make_reply_window(const std::vector<int>& bits, int data_bits, float T, float snr_db, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> uni(0, 1);
+    gr_complex h = std::polar(0.05f, 6.2832f * uni(rng));
+    std::vector<gr_complex> x(reply_window_samples(link_params(LINK_BLF40_FM0), data_bits, T));
+    qa_add_reply(x, qa_reply_chips<fm0>(bits), (0.25f + uni(rng)) * T, T / fm0::CHIPS, h);
+    qa_add_noise(x, h, snr_db, rng);
+    return x;
+}
+
+BOOST_AUTO_TEST_CASE(t_epc_hard_vs_viterbi)
+{
+    const float fs = 2e6f;
+    const float T = link_params(LINK_BLF40_FM0).tag_bit_d() * fs / 1e6f;
+    const int n_windows = 300, n_tags = 32;
+
+    // 标签表只记 n_tags 个不同的 EPC，不会触发 NUMBER_UNIQUE_TAGS 终止
+    std::mt19937 rng(1);
+    std::vector<std::vector<int>> epcs;
+    for (int i = 0; i < n_tags; i++)
+        epcs.push_back(make_epc(rng));
+
+    std::printf("FM0 EPC windows (BLF 40 kHz, 2 MS/s), %d per SNR, random phase and T1\n", n_windows);
+    std::printf("  SNR     EPC CRC ok: hard  Viterbi    us/window: hard  Viterbi\n");
+    for (float snr_db : {-9.0f, -8.0f, -6.0f, 0.0f})
+    {
+        qa_burst_stream stream;
+        for (int k = 0; k < n_windows; k++)
+            stream.add(DECODER_DECODE_EPC, LINK_BLF40_FM0, make_reply_window(epcs[k % n_tags], EPC_BITS, T, snr_db, rng));
+
+        int n_ok[2];
+        double us[2];
+        for (DECODER_MODE mode : {DECODER_MODE_HARD, DECODER_MODE_VITERBI})
+        {
+            READER_STATE::sptr state = READER_STATE::make();
+            us[mode] = run_decoder(stream, state, fs, mode) / n_windows * 1e6;
+            n_ok[mode] = state->reader_stats.n_epc_correct;
+        }
+        std::printf("  %4.0f dB  %16d  %7d  %15.1f  %7.1f\n", snr_db,
+                    n_ok[DECODER_MODE_HARD], n_ok[DECODER_MODE_VITERBI], us[DECODER_MODE_HARD], us[DECODER_MODE_VITERBI]);
+
+        // 网格译码一个半比特出错只影响一个比特，同一 SNR 下通过 CRC 的 EPC 不少于硬判决；
+        // 硬判决开始大量出错的区间里要明显更多
+        BOOST_CHECK_GE(n_ok[DECODER_MODE_VITERBI], n_ok[DECODER_MODE_HARD]);
+        if (snr_db == -8)
+            BOOST_CHECK_GT(n_ok[DECODER_MODE_VITERBI], 2 * n_ok[DECODER_MODE_HARD]);
+        if (snr_db >= 0)
+        {
+            BOOST_CHECK_EQUAL(n_ok[DECODER_MODE_HARD], n_windows);
+            BOOST_CHECK_EQUAL(n_ok[DECODER_MODE_VITERBI], n_windows);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_gate_sync_reused)
+{
+    const float fs = 2e6f;
+    const LINK_PARAMS link = link_params(LINK_BLF40_FM0);
+    const float T = link.tag_bit_d() * fs / 1e6f;
+    const int n_windows = 300, n_tags = 32;
+    std::mt19937 rng(3);
+    std::vector<std::vector<int>> epcs;
+    for (int i = 0; i < n_tags; i++)
+        epcs.push_back(make_epc(rng));
+
+    // 同一批窗口：一份由 decoder 自己搜索前导码，另一份带着 gate 在窗口开头的搜索结果
+    const int n_detect = reply_window_samples(link, 0, T);
+    preamble_detector gate_preamble(T);
+    qa_burst_stream own, synced;
+    for (int k = 0; k < n_windows; k++)
+    {
+        std::vector<gr_complex> x = make_reply_window(epcs[k % n_tags], EPC_BITS, T, -6, rng);
+        gate_preamble.load(x.data(), n_detect);
+        preamble_sync sync = gate_preamble.search<fm0>(PREAMBLE_SEARCH_BITS * T, BLF_TOLERANCE);
+        own.add(DECODER_DECODE_EPC, LINK_BLF40_FM0, x);
+        synced.add(DECODER_DECODE_EPC, LINK_BLF40_FM0, x, &sync);
+    }
+
+    READER_STATE::sptr own_state = READER_STATE::make(), synced_state = READER_STATE::make();
+    double own_us = run_decoder(own, own_state, fs, DECODER_MODE_HARD) / n_windows * 1e6;
+    double synced_us = run_decoder(synced, synced_state, fs, DECODER_MODE_HARD) / n_windows * 1e6;
+    std::printf("FM0 EPC windows at -6 dB: decoder search %d CRC ok, %.1f us/window; gate sync %d CRC ok, %.1f us/window\n",
+                own_state->reader_stats.n_epc_correct, own_us, synced_state->reader_stats.n_epc_correct, synced_us);
+
+    // gate 与 decoder 在同一段样点上做同样的搜索，沿用 gate 的结果不改变判决
+    BOOST_CHECK_EQUAL(synced_state->reader_stats.n_epc_correct, own_state->reader_stats.n_epc_correct);
+}
+
+// 一个 RN16 窗口，n_replies 个标签同时回复（0 为空 slot）。每个标签的 BLF 偏差 ±2%、相位与 T1 随机；
+// 第一个标签幅度为 1，其余相对它弱 0~6 dB，SNR 以第一个标签为准
+static std::vector<gr_complex> make_rn16_window(int n_replies, float T, float snr_db, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> uni(0, 1);
+    const gr_complex h0(0.05f, 0);
+    std::vector<gr_complex> x(reply_window_samples(link_params(LINK_BLF40_FM0), RN16_BITS, T));
+    for (int r = 0; r < n_replies; r++)
+    {
+        std::vector<int> bits(RN16_BITS - 1);
+        for (int& b : bits)
+            b = rng() & 1;
+        float T_tag = T * (1 + 0.04f * (uni(rng) - 0.5f));
+        float amp = (r == 0) ? 1 : std::pow(10.0f, -6 * uni(rng) / 20);
+        gr_complex h = h0 * std::polar(amp, 6.2832f * uni(rng));
+        qa_add_reply(x, qa_reply_chips<fm0>(bits), (0.25f + 2.25f * uni(rng)) * T, T_tag / fm0::CHIPS, h);
+    }
+    qa_add_noise(x, h0, snr_db, rng);
+    return x;
+}
+
+BOOST_AUTO_TEST_CASE(t_rn16_slot_confusion_matrix)
+{
+    const float fs = 2e6f;
+    const float T = link_params(LINK_BLF40_FM0).tag_bit_d() * fs / 1e6f;
+    const int n_windows = 500;
+    const char* names[] = { "empty", "single", "collision" };
+    std::mt19937 rng(2);
+
+    std::printf("RN16 slot classifier, %d windows per cell (second tag 0..-6 dB, +-2%% BLF)\n", n_windows);
+    std::printf("  SNR     truth        -> empty   single  collision\n");
+    for (float snr_db : {-6.0f, 0.0f, 10.0f, 20.0f})
+    {
+        for (int truth = 0; truth < 3; truth++)
+        {
+            qa_burst_stream stream;
+            for (int k = 0; k < n_windows; k++)
+                stream.add(DECODER_DECODE_RN16, LINK_BLF40_FM0, make_rn16_window(truth, T, snr_db, rng));
+            READER_STATE::sptr state = READER_STATE::make();
+            run_decoder(stream, state, fs, DECODER_MODE_HARD);
+
+            const READER_STATS& stats = state->reader_stats;
+            int n[3] = { stats.n_slots_empty, stats.n_slots_single, stats.n_slots_collision };
+            std::printf("  %4.0f dB  %-10s   %6.1f%%  %6.1f%%  %8.1f%%\n", snr_db, names[truth],
+                        100.0 * n[0] / n_windows, 100.0 * n[1] / n_windows, 100.0 * n[2] / n_windows);
+            BOOST_CHECK_EQUAL(n[0] + n[1] + n[2], n_windows);
+
+            // 空 slot 在任何 SNR 下都判为空；单个回复从 0 dB 起都判为单个（不会因误判碰撞而漏掉 ACK）
+            if (truth == 0)
+                BOOST_CHECK_EQUAL(n[0], n_windows);
+            if (truth == 1 && snr_db >= 0)
+                BOOST_CHECK_EQUAL(n[1], n_windows);
+            if (truth == 2 && snr_db >= 0)
+                BOOST_CHECK_GE(n[2], 0.9 * n_windows);
+        }
+    }
+}
+
+} // namespace reader
+} // namespace gr
@@ -0,0 +1,146 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "tone_synth.h"
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+static const double FS = 25e6;
+
+// 第 k 路：频率在 ±(0.5 + 0.4 k) MHz 之间交替，幅度均分 0.3
+static void make_tones(int n, std::vector<float>& freqs, std::vector<float>& amps)
+{
+    freqs.clear();
+    amps.clear();
+    for (int k = 0; k < n; k++)
+    {
+        freqs.push_back((k % 2 ? -1 : 1) * (0.5e6f + 0.4e6f * k));
+        amps.push_back(0.3f / n);
+    }
+}
+
+// 改动前 reader_impl 的做法：每路每个样点一次 std::cos，相位从 0 开始（set_link() 时建表，之后整段重放）
+static void legacy_build(float* out, size_t n, const std::vector<float>& freqs, const std::vector<float>& amps)
+{
+    const double two_pi = 2.0 * M_PI;
+    std::vector<double> phase(freqs.size(), 0.0), phase_inc(freqs.size());
+    double max_cw_amps = 1;
+    for (size_t k = 0; k < freqs.size(); k++)
+    {
+        phase_inc[k] = two_pi * (double) freqs[k] / FS;
+        max_cw_amps -= amps[k];
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        float s = max_cw_amps;
+        for (size_t k = 0; k < freqs.size(); k++)
+        {
+            s += (float) amps[k] * (float) std::cos(phase[k]);
+            phase[k] += phase_inc[k];
+            if (phase[k] >= two_pi) phase[k] -= two_pi;
+            else if (phase[k] < 0.0) phase[k] += two_pi;
+        }
+        out[i] = s;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_tone_synth_phase_continuity)
+{
+    // 多音 CW 段与其他波形段交替，中途改一次频率；与按绝对样点序号直接算 cos 的结果比较
+    std::vector<float> freqs, amps;
+    make_tones(3, freqs, amps);
+    tone_synth synth(FS);
+    synth.set_tones(freqs, amps);
+
+    std::vector<double> phase(freqs.size(), 0.0);
+    std::vector<float> out(4096);
+    double max_err = 0;
+    const size_t segments[] = { 1250, 333, 4096, 1, 77, 2000, 64, 129 };
+    for (int round = 0; round < 200; round++)
+    {
+        if (round == 100)
+        {
+            // 改频率：已有的路保留相位，之后按新增量推进
+            freqs[1] *= 1.5f;
+            synth.set_tones(freqs, amps);
+        }
+        for (size_t s = 0; s < sizeof(segments) / sizeof(segments[0]); s++)
+        {
+            // 奇数段是其他波形：只推进相位
+            size_t seg = segments[s];
+            bool tones = (s % 2 == 0);
+            if (tones)
+                synth.synth(out.data(), seg);
+            else
+                synth.advance(seg);
+            for (size_t i = 0; i < seg; i++)
+            {
+                double ref = 1;
+                for (size_t k = 0; k < freqs.size(); k++)
+                {
+                    ref += amps[k] * (std::cos(phase[k]) - 1);
+                    phase[k] = std::fmod(phase[k] + 2 * M_PI * freqs[k] / FS, 2 * M_PI);
+                }
+                if (tones)
+                    max_err = std::max(max_err, std::abs(out[i] - ref));
+            }
+        }
+    }
+    std::printf("tone_synth, 3 tones, 200 rounds of mixed segments: max |error| %.2e\n", max_err);
+    BOOST_CHECK_LT(max_err, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(t_tone_synth_cost)
+{
+    const size_t chunk = 1250, n_chunks = 4000;
+    // 旧做法建表覆盖 T1 + T2 + EPC 的 CW，约 3.6 ms
+    const size_t table = 90000;
+    std::vector<float> out(chunk), old_table(table);
+
+    std::printf("multi-tone CW at %.0f MS/s, %zu-sample chunks (ns per output sample)\n", FS / 1e6, chunk);
+    std::printf("  tones   synth   old replay   old table build\n");
+    for (int n_tones : {1, 3, 8})
+    {
+        std::vector<float> freqs, amps;
+        make_tones(n_tones, freqs, amps);
+        tone_synth synth(FS);
+        synth.set_tones(freqs, amps);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < n_chunks; c++)
+            synth.synth(out.data(), chunk);
+        auto t1 = std::chrono::steady_clock::now();
+        legacy_build(old_table.data(), table, freqs, amps);
+        auto t2 = std::chrono::steady_clock::now();
+        volatile float sink = 0;   // 防止重放的拷贝被优化掉
+        for (size_t c = 0; c < n_chunks; c++)
+        {
+            std::memcpy(out.data(), old_table.data() + (c * chunk) % (table - chunk), chunk * sizeof(float));
+            sink = sink + out[c % chunk];
+        }
+        auto t3 = std::chrono::steady_clock::now();
+
+        double n = (double) chunk * n_chunks;
+        double ns_synth  = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+        double ns_build  = std::chrono::duration<double, std::nano>(t2 - t1).count() / table;
+        double ns_replay = std::chrono::duration<double, std::nano>(t3 - t2).count() / n;
+        std::printf("  %5d   %5.2f   %10.2f   %15.1f\n", n_tones, ns_synth, ns_replay, ns_build);
+
+        // 重放预先算好的表更便宜，但换频率要重建整张表；合成每个样点的代价要远低于建表
+        BOOST_CHECK_LT(ns_synth, ns_build);
+    }
+}
+
+} // namespace reader
+} // namespace gr
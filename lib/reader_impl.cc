@@ -6,99 +6,157 @@
  */
 
 #include "reader_impl.h"
+#include "crc.h"
 #include <gnuradio/io_signature.h>
 #include <sys/time.h>
 #include <gnuradio/reader/global_vars.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
 
 namespace gr {
 namespace reader {
 
-using input_type = float;
 using output_type = float;
-reader::sptr reader::make(float sample_rate, float dac_rate, int num_sines, std::vector<float> freqs, std::vector<float> amps) {
-    return gnuradio::make_block_sptr<reader_impl>(sample_rate, dac_rate, num_sines, freqs, amps); 
+reader::sptr reader::make(READER_STATE::sptr reader_state, float sample_rate, float dac_rate, int num_sines, std::vector<float> freqs, std::vector<float> amps,
+                          LINK_PROFILE link_profile) {
+    return gnuradio::make_block_sptr<reader_impl>(reader_state, sample_rate, dac_rate, num_sines, freqs, amps, link_profile); 
 }
 
 
 /*
  * The private constructor
  */
-reader_impl::reader_impl(float sample_rate, float dac_rate, int num_sines, std::vector<float> freqs, std::vector<float> amps)
+reader_impl::reader_impl(READER_STATE::sptr state, float sample_rate, float dac_rate, int num_sines, std::vector<float> freqs, std::vector<float> amps,
+                         LINK_PROFILE link_profile)
     : gr::block("reader",
-                gr::io_signature::make(
-                    1 /* min inputs */, 1 /* max inputs */, sizeof(input_type)),
+                gr::io_signature::make(0, 0, 0),
                 gr::io_signature::make(
                     1 /* min outputs */, 1 /*max outputs */, sizeof(output_type))),
-                    d_num_sines(num_sines), d_freqs(freqs), d_amps(amps)
+                    d_tones(dac_rate), reader_state(state), d_next_profile(link_profile)
 {
     GR_LOG_INFO(d_logger, "block initialized");
 
     sample_d = 1.0 / dac_rate * pow(10,6);
 
-    // Number of samples for transmitting
+    // 额外载波取 freqs/amps 的前 num_sines 路，之后可由 set_tones() 或 "tones" 消息端口改变
+    if (num_sines < 0 || (size_t)num_sines > freqs.size() || (size_t)num_sines > amps.size())
+        throw std::invalid_argument("reader: num_sines exceeds the length of freqs/amps");
+    d_freqs.assign(freqs.begin(), freqs.begin() + num_sines);
+    d_amps.assign(amps.begin(), amps.begin() + num_sines);
+    d_tones.set_tones(d_freqs, d_amps);
+    d_tones_changed = false;
 
-    n_data0_s = 2 * PW_D / sample_d;
-    n_data1_s = 4 * PW_D / sample_d;
-    n_pw_s    = PW_D    / sample_d;
-    n_cw_s    = CW_D    / sample_d;
-    n_delim_s = DELIM_D / sample_d;
-    n_trcal_s = TRCAL_D / sample_d;
+    message_port_register_in(pmt::mp("tones"));
+    set_msg_handler(pmt::mp("tones"), [this](const pmt::pmt_t& msg) { handle_tones(msg); });
 
-    // CW waveforms of different sizes
-    n_cwquery_s   = (T1_D+T2_D+RN16_D)/sample_d;     //RN16
-    n_cwack_s     = (3*T1_D+T2_D+EPC_D)/sample_d;    //EPC   if it is longer than nominal it wont cause tags to change inventoried flag
-    n_p_down_s    = (P_DOWN_D)/sample_d;
-    n_extra_cw    = (T1_D+T2_D+EPC_D)/sample_d;
+    // 按初始链路参数生成各段波形，并交给 gate/tag_decoder（第一条 SEEK 之前）
+    set_link(link_params(link_profile));
+    reader_state->link = link;
+    reader_state->tx_rate = dac_rate;
 
-    p_down.resize(n_p_down_s);        // Power down samples
-    cw_query.resize(n_cwquery_s);      // Sent after query/query rep
-    cw_ack.resize(n_cwack_s);          // Sent after ack
-    extra_cw.resize(n_cwack_s);
+    // 还没有命令在发送
+    tx_begin();
+    d_tx_clock = 0;
+    d_turnaround_seq = 0;
 
-    std::fill_n(cw_query.begin(), cw_query.size(), 1);
-    std::fill_n(cw_ack.begin(), cw_ack.size(), 1);
+}
 
-    // creat extra cw
-    {
+void reader_impl::set_link_profile(LINK_PROFILE link_profile)
+{
+    link_params(link_profile);   // 未知的 profile 在调用处抛出异常
+    d_next_profile.store(link_profile, std::memory_order_relaxed);
+}
 
-    std::vector<double> phase(num_sines, 0.0);        // φ_k：每路初始相位
-    std::vector<double> phase_inc(num_sines, 0.0);    // Δφ_k：每路相位增量
+void reader_impl::set_tones(const std::vector<float>& freqs, const std::vector<float>& amps)
+{
+    if (freqs.size() != amps.size())
+        throw std::invalid_argument("reader: freqs and amps must have the same length");
 
-    const double two_pi = 2.0 * M_PI;
+    gr::thread::scoped_lock guard(d_setlock);
+    d_freqs = freqs;
+    d_amps = amps;
+    d_tones_changed = true;
+}
 
-    double max_cw_amps = 1;
-    for (int k = 0; k < num_sines; k++) {
-        phase_inc[k] = two_pi * (double)freqs[k] / (double)dac_rate;
-        max_cw_amps -= amps[k];
+// 把 f32/f64 向量或数值列表转换成 std::vector<float>
+static bool pmt_to_floats(const pmt::pmt_t& v, std::vector<float>& out)
+{
+    out.clear();
+    if (pmt::is_f32vector(v))
+        out = pmt::f32vector_elements(v);
+    else if (pmt::is_f64vector(v))
+    {
+        for (double x : pmt::f64vector_elements(v))
+            out.push_back(x);
     }
-    
-    for (size_t n = 0; n < extra_cw.size(); n++) {
+    else if (pmt::is_pair(v) || pmt::is_null(v))
+    {
+        for (pmt::pmt_t p = v; pmt::is_pair(p); p = pmt::cdr(p))
+        {
+            if (!pmt::is_real(pmt::car(p)) && !pmt::is_integer(pmt::car(p)))
+                return false;
+            out.push_back(pmt::to_double(pmt::car(p)));
+        }
+    }
+    else
+        return false;
+    return true;
+}
 
-        float s = max_cw_amps;  // base CW（你原来的 cw_ack/cw_query 就是全 1）
+void reader_impl::handle_tones(const pmt::pmt_t& msg)
+{
+    // 消息为字典 {freqs: [...], amps: [...]}；格式不对只告警，不能让 flowgraph 停下来
+    std::vector<float> freqs, amps;
+    if (!pmt::is_dict(msg) ||
+        !pmt_to_floats(pmt::dict_ref(msg, pmt::mp("freqs"), pmt::PMT_F), freqs) ||
+        !pmt_to_floats(pmt::dict_ref(msg, pmt::mp("amps"), pmt::PMT_F), amps) ||
+        freqs.size() != amps.size())
+    {
+        GR_LOG_WARN(d_logger, "tones: expected a dict {freqs: [...], amps: [...]} of equal length, message ignored");
+        return;
+    }
+    set_tones(freqs, amps);
+}
 
-        for (int k = 0; k < num_sines; k++) {
-            // amps[k]*cos(phase[k]) 是第 k 路在该样点的贡献（实数）
-            s += (float)amps[k] * (float)std::cos(phase[k]);
+void reader_impl::set_link(const LINK_PARAMS& l)
+{
+    link = l;
 
-            // 相位推进：下一个样点相位增加 Δφ_k
-            phase[k] += phase_inc[k];
+    // 标签回复窗口：与 gate 的放行长度一致（起点搜索范围 + pilot + 前导码 + 数据 + 1 bit，按 BLF 偏差放宽）。
+    // 命令后的 CW 必须覆盖整个窗口，decoder 给出结果后剩余部分会被截断
+    float head_bits = PREAMBLE_SEARCH_BITS + link.pilot_bits() + link.preamble_bits() + 1;
+    float rn16_d = (RN16_BITS + head_bits) * link.tag_bit_d() * (1 + BLF_TOLERANCE);
+    float epc_d  = (EPC_BITS  + head_bits) * link.tag_bit_d() * (1 + BLF_TOLERANCE);
 
-            // 相位回绕到 [0, 2π)：避免相位无限变大导致 cos 精度变差
-            if (phase[k] >= two_pi) phase[k] -= two_pi;
-            else if (phase[k] < 0.0) phase[k] += two_pi;
-        }
-        extra_cw[n] = s;
-    }
-    }
+    // Number of samples for transmitting
 
-    // Construct vectors (resize() default initialization is zero)
-    data_0.resize(n_data0_s);
-    data_1.resize(n_data1_s);
-    cw.resize(n_cw_s);
-    delim.resize(n_delim_s);
-    rtcal.resize(n_data0_s + n_data1_s);
-    trcal.resize(n_trcal_s);
+    n_data0_s = link.tari_d     / sample_d;
+    n_data1_s = 2 * link.tari_d / sample_d;
+    n_pw_s    = link.pw_d()     / sample_d;
+    n_cw_s    = CW_D    / sample_d;
+    n_delim_s = DELIM_D / sample_d;
+    n_trcal_s = link.trcal_d    / sample_d;
+
+    // CW waveforms of different sizes
+    n_cwquery_s   = (link.t1_d + link.t2_d + rn16_d)/sample_d;     //RN16
+    n_cwack_s     = (3*link.t1_d + link.t2_d + epc_d)/sample_d;    //EPC   if it is longer than nominal it wont cause tags to change inventoried flag
+    n_p_down_s    = (P_DOWN_D)/sample_d;
+    n_cw_chunk_s  = CW_CHUNK_D/sample_d;
+
+    p_down.assign(n_p_down_s, 0);      // Power down samples
+    cw_query.assign(n_cwquery_s, 1);   // Sent after query/query rep
+    cw_ack.assign(n_cwack_s, 1);       // Sent after ack
+
+    // Construct vectors (assign() initializes to zero)
+    data_0.assign(n_data0_s, 0);
+    data_1.assign(n_data1_s, 0);
+    cw.assign(n_cw_s, 0);
+    delim.assign(n_delim_s, 0);
+    rtcal.assign(n_data0_s + n_data1_s, 0);
+    trcal.assign(n_trcal_s, 0);
 
     // Fill vectors with data
     std::fill_n(data_0.begin(), data_0.size()/2, 1);
@@ -108,17 +166,20 @@ reader_impl::reader_impl(float sample_rate, float dac_rate, int num_sines, std::
     std::fill_n(trcal.begin(), trcal.size() - n_pw_s, 1); // TRcal
 
     // create preamble
+    preamble.clear();
     preamble.insert( preamble.end(), delim.begin(), delim.end() );
     preamble.insert( preamble.end(), data_0.begin(), data_0.end() );
     preamble.insert( preamble.end(), rtcal.begin(), rtcal.end() );
     preamble.insert( preamble.end(), trcal.begin(), trcal.end() );
 
     // create framesync
+    frame_sync.clear();
     frame_sync.insert( frame_sync.end(), delim.begin() , delim.end() );
     frame_sync.insert( frame_sync.end(), data_0.begin(), data_0.end() );
     frame_sync.insert( frame_sync.end(), rtcal.begin() , rtcal.end() );
     
     // create query rep
+    query_rep.clear();
     query_rep.insert( query_rep.end(), frame_sync.begin(), frame_sync.end());
     query_rep.insert( query_rep.end(), data_0.begin(), data_0.end() );
     query_rep.insert( query_rep.end(), data_0.begin(), data_0.end() );
@@ -126,6 +187,7 @@ reader_impl::reader_impl(float sample_rate, float dac_rate, int num_sines, std::
     query_rep.insert( query_rep.end(), data_0.begin(), data_0.end() );
 
     // create nak
+    nak.clear();
     nak.insert( nak.end(), frame_sync.begin(), frame_sync.end());
     nak.insert( nak.end(), data_1.begin(), data_1.end() );
     nak.insert( nak.end(), data_1.begin(), data_1.end() );
@@ -135,13 +197,6 @@ reader_impl::reader_impl(float sample_rate, float dac_rate, int num_sines, std::
     nak.insert( nak.end(), data_0.begin(), data_0.end() );
     nak.insert( nak.end(), data_0.begin(), data_0.end() );
     nak.insert( nak.end(), data_0.begin(), data_0.end() );
-
-    // init local buffer
-    d_tx_buf.resize(0); d_tx_pos = 0;
-
-    gen_query_bits();
-    gen_query_adjust_bits();
-
 }
 
 /*
@@ -151,78 +206,72 @@ reader_impl::~reader_impl() {
     print_results();
 }
 
-void reader_impl::forecast(int noutput_items, gr_vector_int& ninput_items_required)
-{
-    ninput_items_required[0] = 0;
-}
-
 int reader_impl::general_work(int noutput_items,
                               gr_vector_int& ninput_items,
                               gr_vector_const_void_star& input_items,
                               gr_vector_void_star& output_items)
 {
-    auto in = static_cast<const input_type*>(input_items[0]);
     auto out = static_cast<output_type*>(output_items[0]);
 
-    std::vector<float> out_message; 
-    // int n_output;
-    int consumed = 0;
-    int written = 0;
-
-    // consumed = ninput_items[0];
-
-    // 将本地缓冲区的数据先输出
-    if (!d_tx_buf.empty()) 
+    // 多音参数只在工作线程里切换；保留已有各路的相位
     {
-        GR_LOG_INFO(d_debug_logger, "Output Buffer");
-        const size_t remain = d_tx_buf.size() - d_tx_pos;
-        const size_t n = std::min(remain, (size_t)noutput_items);
-        std::memcpy(out + written, d_tx_buf.data() + d_tx_pos, n * sizeof(float));
-        d_tx_pos += n;
-        written += n;
-        if (d_tx_pos == d_tx_buf.size()) {
-            d_tx_buf.clear();
-            d_tx_pos = 0;
+        gr::thread::scoped_lock guard(d_setlock);
+        if (d_tones_changed)
+        {
+            d_tones.set_tones(d_freqs, d_amps);
+            d_tones_changed = false;
         }
+    }
 
-        consume_each(0);
-        return written;
+    // 先把正在发送的命令写完
+    if (tx_busy())
+    {
+        // 已进入命令之后的 CW，且 decoder 已经给出下一步（空 slot 提前判决或回复已解完）：
+        // 丢弃剩余的 CW，在本次调用里直接发下一条命令
+        if (d_tx_segs[d_tx_seg].cuttable && reader_state->gen2_logic_status.load(std::memory_order_acquire) != IDLE)
+        {
+            GR_LOG_INFO(d_debug_logger, "CUT CW");
+        }
+        else
+        {
+            GR_LOG_INFO(d_debug_logger, "Output Buffer");
+            return render(out, noutput_items);
+        }
     }
 
-    // 清理缓冲区
-    d_tx_buf.clear();
-    d_tx_pos = 0;
+    tx_begin();
 
-    switch (reader_state->gen2_logic_status)
+    // IDLE 时阻塞等待 decoder 的下一步决定，而不是空转返回 0
+    switch (reader_state->wait_gen2_logic_status(IDLE, IDLE_WAIT_MS))
     {
         case START: {
             GR_LOG_INFO(d_debug_logger, "START");
             
-            append_vec(d_tx_buf, cw_ack);
-            reader_state->gen2_logic_status = SEND_QUERY;
+            tx_push(cw_ack);
+            advance_logic(START, SEND_QUERY);
         }
             break;
 
         case POWER_DOWN: {
             GR_LOG_INFO(d_debug_logger, "POWER DOWN");
-            append_vec(d_tx_buf, p_down);
-            reader_state->gen2_logic_status = START;
+            tx_push(p_down);
+            advance_logic(POWER_DOWN, START);
         }   
             break;
 
         case SEND_NAK_QR: {
             GR_LOG_INFO(d_debug_logger, "SEND NAK");
-            append_vec(d_tx_buf, nak);
-            append_vec(d_tx_buf, cw);
-            reader_state->gen2_logic_status = SEND_QUERY_REP;
+            tx_push(nak);
+            tx_push(cw);
+            advance_logic(SEND_NAK_QR, SEND_QUERY_REP);
         }
             break;
 
         case SEND_NAK_Q: {
             GR_LOG_INFO(d_debug_logger, "SEND NAK");
-            append_vec(d_tx_buf, nak);
-            append_vec(d_tx_buf, cw);
-            reader_state->gen2_logic_status = SEND_QUERY;
+            tx_push(nak);
+            tx_push(cw);
+            advance_logic(SEND_NAK_Q, SEND_QUERY);
         }
             break;
 
@@ -231,118 +280,99 @@ int reader_impl::general_work(int noutput_items,
             GR_LOG_INFO(d_debug_logger, "QUERY");
             // GR_LOG_INFO(d_debug_logger, "INVENTORY ROUND : " << reader_state->reader_stats.cur_inventory_round << " SLOT NUMBER : " << reader_state->reader_stats.cur_slot_number);
 
-            reader_state->reader_stats.n_queries_sent +=1;
-
-            // Controls the other two blocks
-            reader_state->decoder_status = DECODER_DECODE_RN16;
-            reader_state->gate_status    = GATE_SEEK_RN16;
+            reader_state->reader_stats.n_queries_sent.fetch_add(1, std::memory_order_relaxed);
 
-            append_vec(d_tx_buf, preamble);
-
-            for(size_t i = 0; i < query_bits.size(); i++)
+            // 链路参数只在新一轮开始时切换：Query 之后的所有命令与回复都使用同一组参数
+            LINK_PROFILE next_profile = d_next_profile.load(std::memory_order_relaxed);
+            if (next_profile != link.profile)
             {
-                if(query_bits[i] == 1)
-                {
-                    append_vec(d_tx_buf, data_1);
-                }
-                else
-                {
-                    append_vec(d_tx_buf, data_0);
-                }
+                GR_LOG_INFO(d_logger, "link profile " + std::to_string(link.profile) + " -> " + std::to_string(next_profile));
+                set_link(link_params(next_profile));
             }
+            // 随 SEEK 一起发布给 gate
+            reader_state->link = link;
+
+            // Q 由 decoder 的防碰撞策略在切换到 SEND_QUERY 之前写入上下文
+            gen_query_bits(reader_state->q);
+
+            tx_push(preamble);
+
+            tx_push_bits(query_bits);
+
+            // Return to IDLE（在 SEEK 之前：之后 decoder 随时可能发布这条命令的结果）
+            advance_logic(SEND_QUERY, IDLE);
+
+            // Controls the other two blocks
+            publish_seek(GATE_SEEK_RN16);
             
             // Send CW for RN16
-            append_vec(d_tx_buf, cw_query);
-
-            // Return to IDLE
-            reader_state->gen2_logic_status = IDLE;
+            tx_push(cw_query, true);
         }
             break;
 
         case SEND_ACK: {
             GR_LOG_INFO(d_debug_logger, "SEND ACK");
 
-            if (ninput_items[0] == RN16_BITS - 1)
-            {
-                // Controls the other two blocks
-                reader_state->decoder_status = DECODER_DECODE_EPC;
-                reader_state->gate_status    = GATE_SEEK_EPC;
-
-                gen_ack_bits(in);
-                
-                // Send FrameSync
-                append_vec(d_tx_buf, frame_sync);
-
-                for(size_t i = 0; i < ack_bits.size(); i++)
-                {
-                    if(ack_bits[i] == 1)
-                    {
-                        append_vec(d_tx_buf, data_1);
-                    }
-                    else  
-                    {
-                        append_vec(d_tx_buf, data_0);
-                    }
-                }
-                
-                consumed = ninput_items[0];
-                if(d_num_sines == 0) reader_state->gen2_logic_status = SEND_CW;
-                else reader_state->gen2_logic_status = SEND_EXTRA_CW;
-            }
+            // RN16 由 decoder 在切换到 SEND_ACK 之前写入上下文
+            gen_ack_bits(reader_state->rn16);
+
+            // Send FrameSync
+            tx_push(frame_sync);
+            tx_push_bits(ack_bits);
+
+            if(d_tones.size() == 0) advance_logic(SEND_ACK, SEND_CW);
+            else advance_logic(SEND_ACK, SEND_EXTRA_CW);
+
+            // Controls the other two blocks
+            publish_seek(GATE_SEEK_EPC);
         }
             break;
 
         case SEND_CW: {
             GR_LOG_INFO(d_debug_logger, "SEND CW");
-            append_vec(d_tx_buf, cw_ack);
-            reader_state->gen2_logic_status = IDLE;      // Return to IDLE
+            tx_push(cw_ack, true);
+            advance_logic(SEND_CW, IDLE);      // Return to IDLE
         }
             break;
 
         case SEND_EXTRA_CW: {
             GR_LOG_INFO(d_debug_logger, "SEND EXTRA CW");
-            append_vec(d_tx_buf, extra_cw);
-            reader_state->gen2_logic_status = IDLE;      // Return to IDLE
+            tx_push_tones(cw_ack.size());
+            advance_logic(SEND_EXTRA_CW, IDLE);      // Return to IDLE
         }
             break;
         case SEND_QUERY_REP: {
             GR_LOG_INFO(d_debug_logger, "SEND QUERY_REP");
             // GR_LOG_INFO(d_debug_logger, "INVENTORY ROUND : " << reader_state->reader_stats.cur_inventory_round << " SLOT NUMBER : " << reader_state->reader_stats.cur_slot_number);
             
-            // Controls the other two blocks
-            reader_state->decoder_status = DECODER_DECODE_RN16;
-            reader_state->gate_status    = GATE_SEEK_RN16;
-            reader_state->reader_stats.n_queries_sent +=1;
+            reader_state->reader_stats.n_queries_sent.fetch_add(1, std::memory_order_relaxed);
 
-            append_vec(d_tx_buf, query_rep);
-            append_vec(d_tx_buf, cw_query);
+            tx_push(query_rep);
 
-            reader_state->gen2_logic_status = IDLE;    // Return to IDLE
+            advance_logic(SEND_QUERY_REP, IDLE);    // Return to IDLE
+
+            // Controls the other two blocks
+            publish_seek(GATE_SEEK_RN16);
+            tx_push(cw_query, true);
         }
             break;
         
         case SEND_QUERY_ADJUST: {
             GR_LOG_INFO(d_debug_logger, "SEND QUERY_ADJUST");
-            // Controls the other two blocks
-            reader_state->decoder_status = DECODER_DECODE_RN16;
-            reader_state->gate_status    = GATE_SEEK_RN16;
-            reader_state->reader_stats.n_queries_sent +=1;  
+            reader_state->reader_stats.n_queries_sent.fetch_add(1, std::memory_order_relaxed);
 
-            append_vec(d_tx_buf, frame_sync);
+            // UpDn 由 decoder 的防碰撞策略在切换到 SEND_QUERY_ADJUST 之前写入上下文
+            gen_query_adjust_bits(reader_state->q_updn);
 
-            for(size_t i = 0; i < query_adjust_bits.size(); i++)
-            {
-                if(query_adjust_bits[i] == 1)
-                {
-                    append_vec(d_tx_buf, data_1);
-                }
-                else
-                {
-                    append_vec(d_tx_buf, data_0);
-                }
-            }
-            append_vec(d_tx_buf, cw_query);
-            reader_state->gen2_logic_status = IDLE;    // Return to IDLE
+            tx_push(frame_sync);
+
+            tx_push_bits(query_adjust_bits);
+
+            advance_logic(SEND_QUERY_ADJUST, IDLE);    // Return to IDLE
+
+            // Controls the other two blocks
+            publish_seek(GATE_SEEK_RN16);
+            tx_push(cw_query, true);
         }
             break;
 
@@ -351,114 +381,146 @@ int reader_impl::general_work(int noutput_items,
             break;
         }
     
-    // 将本地缓冲区的数据输出
-    size_t to_send = std::min(d_tx_buf.size(), (size_t)noutput_items);
-    if (to_send > 0) {
-        std::memcpy(out + written, d_tx_buf.data(), to_send * sizeof(float));
-        d_tx_pos = to_send;
-        written += to_send;
-        if (d_tx_pos == d_tx_buf.size()) {
-            d_tx_buf.clear();
-            d_tx_pos = 0;
-        }
-    }
+    // 输出新命令的第一部分
+    uint64_t seq = reader_state->turnaround_seq.load(std::memory_order_acquire);
+    if (!tx_busy() || seq == d_turnaround_seq)
+        return render(out, noutput_items);
+
+    // 这条命令响应 decoder 的一个新决定：记录生成与交出第一个样点的时刻
+    d_turnaround_seq = seq;
+    uint64_t rendered = wall_clock_ns();
+    int n = render(out, noutput_items);
+    record_turnaround(rendered, wall_clock_ns());
+    return n;
+}
 
-    consume_each (consumed);
-    return written;
+void reader_impl::record_turnaround(uint64_t rendered, uint64_t emitted)
+{
+    if (reader_state->turnaround_path < 0)
+        return;
+    TURNAROUND path = (TURNAROUND) reader_state->turnaround_path;
+    latency_stats& latency = reader_state->latency;
+    latency.at(path, LAT_DECODER_TO_RENDER).record(rendered - reader_state->decided_ns);
+    latency.at(path, LAT_RENDER_TO_EMIT).record(emitted - rendered);
+    latency.at(path, LAT_TOTAL).record(emitted - reader_state->reply_close_ns);
 }
 
-/* Function adapted from https://www.cgran.org/wiki/Gen2 */
-void reader_impl::crc_append(std::vector<float> & q)
+LATENCY_SUMMARY reader_impl::turnaround_latency(TURNAROUND path, LATENCY_STAGE stage) const
 {
-    int crc[] = {1,0,0,1,0};
+    return reader_state->latency.summary(path, stage);
+}
 
-    for(int i = 0; i < 17; i++)
+void reader_impl::advance_logic(GEN2_LOGIC_STATUS from, GEN2_LOGIC_STATUS to)
+{
+    // gate 在每条命令之后都会开门，decoder 的决定（包括没有 SEEK 的窗口）可能在任何时候到达，
+    // 不能无条件覆盖
+    reader_state->gen2_logic_status.compare_exchange_strong(from, to, std::memory_order_acq_rel);
+}
+
+void reader_impl::publish_seek(GATE_STATUS seek)
+{
+    // 新命令从下一个输出样点（d_tx_clock）开始，已加入的段都是命令本身（CW 在之后加入）
+    uint64_t end = d_tx_clock;
+    for (int s = 0; s < d_tx_nseg; s++)
+    {
+        if (d_tx_segs[s].kind != TX_BITS)
+            end += d_tx_segs[s].length;
+        else
+            for (unsigned b = 0; b < d_tx_bits.size(); b++)
+                end += d_tx_bits[b] ? data_1.size() : data_0.size();
+    }
+    reader_state->tx_command_start = d_tx_clock;
+    reader_state->tx_command_end = end;
+    reader_state->gate_status.store(seek, std::memory_order_release);
+}
+
+int reader_impl::render(float* out, int noutput_items)
+{
+    // 可截断的 CW 每次只交出 n_cw_chunk_s 个样点，decoder 的决定最多晚一个块生效
+    int n = 0;
+    int cw_budget = n_cw_chunk_s;
+    while (n < noutput_items && tx_busy())
     {
-        int tmp[] = {0,0,0,0,0};
-        tmp[4] = crc[3];
-        if(crc[4] == 1)
+        const TX_SEGMENT& seg = d_tx_segs[d_tx_seg];
+        const std::vector<float>* wave = nullptr;
+        size_t length = seg.length;
+        if (seg.kind != TX_TONES)
         {
-            if (q[i] == 1)
-            {
-                tmp[0] = 0;
-                tmp[1] = crc[0];
-                tmp[2] = crc[1];
-                tmp[3] = crc[2];
-            }
-            else
-            {
-                tmp[0] = 1;
-                tmp[1] = crc[0];
-                tmp[2] = crc[1];
-                if(crc[2] == 1)
-                {
-                    tmp[3] = 0;
-                }
-                else
-                {
-                    tmp[3] = 1;
-                }
-            }
+            wave = (seg.kind == TX_WAVE) ? seg.wave : (d_tx_bits[d_tx_bit] ? &data_1 : &data_0);
+            length = wave->size();
+        }
+
+        size_t room = noutput_items - n;
+        if (seg.cuttable)
+        {
+            if (cw_budget == 0)
+                break;
+            room = std::min(room, (size_t)cw_budget);
+        }
+        size_t k = std::min(length - d_tx_pos, room);
+        // 多音载波的相位随输出的每个样点推进，两段多音 CW 之间保持连续
+        if (wave)
+        {
+            std::copy_n(wave->data() + d_tx_pos, k, out + n);
+            d_tones.advance(k);
         }
         else
+            d_tones.synth(out + n, k);
+        n += k;
+        d_tx_pos += k;
+        d_tx_clock += k;
+        if (seg.cuttable)
+            cw_budget -= k;
+
+        // 一段写完进入下一段；比特段逐个比特推进
+        if (d_tx_pos == length)
         {
-            if (q[i] == 1)
-            {
-                tmp[0] = 1;
-                tmp[1] = crc[0];
-                tmp[2] = crc[1];
-                if(crc[2] == 1)
-                {
-                    tmp[3] = 0;
-                }
-                else
-                {
-                    tmp[3] = 1;
-                }
-            }
-            else
+            d_tx_pos = 0;
+            if (seg.kind != TX_BITS || ++d_tx_bit == d_tx_bits.size())
             {
-                tmp[0] = 0;
-                tmp[1] = crc[0];
-                tmp[2] = crc[1];
-                tmp[3] = crc[2];
+                d_tx_bit = 0;
+                d_tx_seg++;
             }
         }
-        memcpy(crc, tmp, 5*sizeof(float));
     }
-    for (int i = 4; i >= 0; i--) q.push_back(crc[i]);
+    return n;
+}
+
+void reader_impl::crc_append(packed_bits<QUERY_LENGTH> & q)
+{
+    uint8_t crc = crc5(q.data(), q.size());
+    for (int i = 4; i >= 0; i--) q.push_back((crc >> i) & 1);
 }
 
-void reader_impl::gen_query_bits()
+void reader_impl::gen_query_bits(int q)
 {
-    // int num_ones = 0, num_zeros = 0;
-
-    query_bits.resize(0);
-    query_bits.insert(query_bits.end(), &QUERY_CODE[0], &QUERY_CODE[4]);
-    query_bits.push_back(DR);
-    query_bits.insert(query_bits.end(), &M[0], &M[2]);
-    query_bits.push_back(TREXT);
-    query_bits.insert(query_bits.end(), &SEL[0], &SEL[2]);
-    query_bits.insert(query_bits.end(), &SESSION[0], &SESSION[2]);
+    query_bits.clear();
+    query_bits.append(QUERY_CODE, 4);
+    query_bits.push_back(link.dr);
+    query_bits.push_back(link.m >> 1);
+    query_bits.push_back(link.m & 1);
+    query_bits.push_back(link.trext);
+    query_bits.append(SEL, 2);
+    query_bits.append(SESSION, 2);
     query_bits.push_back(TARGET);
 
-    query_bits.insert(query_bits.end(), &Q_VALUE[FIXED_Q][0], &Q_VALUE[FIXED_Q][4]);
+    query_bits.append(Q_VALUE[q], 4);
     crc_append(query_bits);
 }
 
-void reader_impl::gen_ack_bits(const float * in)
+void reader_impl::gen_ack_bits(const packed_bits<RN16_BITS - 1> & rn16)
 {
-    ack_bits.resize(0);
-    ack_bits.insert(ack_bits.end(), &ACK_CODE[0], &ACK_CODE[2]);
-    ack_bits.insert(ack_bits.end(), &in[0], &in[16]);
+    ack_bits.clear();
+    ack_bits.append(ACK_CODE, 2);
+    ack_bits.append(rn16);
 }
 
-void reader_impl::gen_query_adjust_bits()
+void reader_impl::gen_query_adjust_bits(int updn)
 {
-    query_adjust_bits.resize(0);
-    query_adjust_bits.insert(query_adjust_bits.end(), &QADJ_CODE[0], &QADJ_CODE[4]);
-    query_adjust_bits.insert(query_adjust_bits.end(), &SESSION[0], &SESSION[2]);
-    query_adjust_bits.insert(query_adjust_bits.end(), &Q_UPDN[1][0], &Q_UPDN[1][3]);
+    query_adjust_bits.clear();
+    query_adjust_bits.append(QADJ_CODE, 4);
+    query_adjust_bits.append(SESSION, 2);
+    query_adjust_bits.append(Q_UPDN[updn], 3);
 }
 
 void reader_impl::print_results()
@@ -466,17 +528,48 @@ void reader_impl::print_results()
     std::cout << "\n --------------------------" << std::endl;
     std::cout << "| Number of queries/queryreps sent : " << reader_state->reader_stats.n_queries_sent - 1 << std::endl;
     std::cout << "| Current Inventory round : "          << reader_state->reader_stats.cur_inventory_round << std::endl;
+    std::cout << "| Slots empty/single/collision : "      << reader_state->reader_stats.n_slots_empty << " / "
+              << reader_state->reader_stats.n_slots_single << " / "
+              << reader_state->reader_stats.n_slots_collision << std::endl;
     std::cout << " --------------------------"            << std::endl;
 
     std::cout << "| Correctly decoded EPC : "  <<  reader_state->reader_stats.n_epc_correct     << std::endl;
     std::cout << "| Number of unique tags : "  <<  reader_state->reader_stats.tag_reads.size() << std::endl;
 
-    std::map<int,int>::iterator it;
-
-    for(it = reader_state->reader_stats.tag_reads.begin(); it != reader_state->reader_stats.tag_reads.end(); it++) 
+    if (reader_state->reader_stats.tag_reads.n_dropped() > 0)
+        std::cout << "| Reads dropped (tag table full) : " << reader_state->reader_stats.tag_reads.n_dropped() << std::endl;
+
+    reader_state->reader_stats.tag_reads.for_each([](const TAG_ENTRY& e) {
+        char epc[2 * TAG_EPC_BYTES + 1];
+        for (int i = 0; i < TAG_EPC_BYTES; i++)
+            snprintf(epc + 2 * i, 3, "%02x", e.epc[i]);
+        std::cout << "| Tag EPC : " << epc << "  ";
+        std::cout << "Num of reads : " << e.n_reads << "  ";
+        std::cout << "RSSI : " << e.last_rssi << " dB" << std::endl;
+    });
+
+    // 转换延迟：air 为回复窗口结束到下一条命令开始（样点时间），其余为墙钟
+    static const char* const PATH_NAMES[N_TURNAROUNDS] = { "RN16 -> ACK", "EPC -> next" };
+    static const char* const STAGE_NAMES[N_LATENCY_STAGES] = { "gate -> decoder", "decoder -> render", "render -> emit", "total (wall)", "air" };
+    bool header = false;
+    for (int p = 0; p < N_TURNAROUNDS; p++)
     {
-        std::cout << std::hex <<  "| Tag ID : " << it->first << "  ";
-        std::cout << "Num of reads : " << std::dec << it->second << std::endl;
+        for (int s = 0; s < N_LATENCY_STAGES; s++)
+        {
+            LATENCY_SUMMARY l = turnaround_latency((TURNAROUND) p, (LATENCY_STAGE) s);
+            if (l.count == 0)
+                continue;
+            if (!header)
+            {
+                std::cout << " --------------------------" << std::endl;
+                std::cout << "| Turnaround latency (us, p50 / p99 / max), T2 max : " << 20 / link.blf() * 1e6 << std::endl;
+                header = true;
+            }
+            char line[128];
+            snprintf(line, sizeof(line), "| %-12s %-18s : %9.2f / %9.2f / %9.2f  (%llu)",
+                     PATH_NAMES[p], STAGE_NAMES[s], l.p50_us, l.p99_us, l.max_us, (unsigned long long) l.count);
+            std::cout << line << std::endl;
+        }
     }
 
     std::cout << " --------------------------" << std::endl;
@@ -9,6 +9,8 @@
 #define INCLUDED_READER_READER_IMPL_H
 
 #include <gnuradio/reader/reader.h>
+#include "tone_synth.h"
+#include <array>
 #include <vector>
 #include <queue>
 #include <fstream>
@@ -27,7 +29,7 @@ private:
     * \details
     * 约定：本文件中带后缀 “_s” 的变量表示“样点数（samples）”，不是秒（seconds）。
     * s_rate/d_rate 用于把协议时序（微秒）换算为样点数；n_*_s 保存各段波形长度（samples）。
-    * data_0/data_1/cw/preamble/query_bits/ack_bits 等向量缓存已生成的基带模板，运行时由状态机拼接输出。
+    * data_0/data_1/cw/preamble/query_bits/ack_bits 等向量缓存已生成的基带模板，运行时由状态机按段引用，直接写入输出缓冲区。
     *
     * \note
     * - s_rate: 基带生成/处理采样率（Hz）。
@@ -47,40 +49,86 @@ private:
     * - p_down: power-down 模板（关载波一段时间以复位标签）。
     *
     * \note
-    * - q_change: QueryAdjust 的 Q 调整方向：0=增，1=不变，2=减。
-    *
-    * \note
-    * - gen_query_bits(): 生成 Query 命令比特序列。
-    * - gen_query_adjust_bits(): 生成 QueryAdjust 命令比特序列（由 q_change 决定 UpDn 字段）。
-    * - gen_ack_bits(in): 用解码得到的 RN16(handle) 生成 ACK 命令比特序列。
+    * - set_link(link): 按链路参数换算各段长度并重建上述模板；只在构造时与 Query 之前调用。
+    * - gen_query_bits(q): 以 decoder 经上下文交来的 Q 生成 Query 命令比特序列。
+    * - gen_query_adjust_bits(updn): 生成 QueryAdjust 命令比特序列，updn 为 Q_UPDN 行号：0=增，1=不变，2=减。
+    * - gen_ack_bits(rn16): 用 decoder 经上下文交来的 RN16(handle) 生成 ACK 命令比特序列。
     * - crc_append(q): 对命令比特序列追加 CRC（Query/QueryAdjust 通常为 CRC5，具体以实现为准）。
     */
     int s_rate, d_rate,  n_cwquery_s,  n_cwack_s,n_p_down_s;
-    float sample_d, n_data0_s, n_data1_s, n_cw_s, n_pw_s, n_delim_s, n_trcal_s, n_extra_cw;
-    std::vector<float> data_0, data_1, cw, cw_ack, cw_query, delim, frame_sync, preamble, rtcal, trcal, query_bits, ack_bits, query_rep,nak, query_adjust_bits,p_down, extra_cw;
-    int q_change; // 0-> increment, 1-> unchanged, 2-> decrement
+    float sample_d, n_data0_s, n_data1_s, n_cw_s, n_pw_s, n_delim_s, n_trcal_s;
+    std::vector<float> data_0, data_1, cw, cw_ack, cw_query, delim, frame_sync, preamble, rtcal, trcal, query_rep,nak, p_down;
+    packed_bits<QUERY_LENGTH> query_bits;            // Query（含 CRC-5）
+    packed_bits<ACK_LENGTH> ack_bits;                // ACK = 01 + RN16
+    packed_bits<QUERY_ADJUST_LENGTH> query_adjust_bits;
     
-    std::vector<float> d_tx_buf; size_t d_tx_pos; // 本地缓冲区以及缓冲区指针
+    // 正在发送的命令：最多 3 段（帧头模板、PIE 比特、命令之后的 CW），由 render() 直接写入输出缓冲区，
+    // 跨 general_work 调用从游标处继续
+    enum TX_SEGMENT_KIND { TX_WAVE, TX_BITS, TX_TONES };
+    struct TX_SEGMENT
+    {
+        TX_SEGMENT_KIND kind;
+        const std::vector<float>* wave;   // TX_WAVE：波形模板
+        size_t length;                    // TX_TONES：由 d_tones 合成的样点数
+        bool cuttable;                    // 命令之后的 CW：decoder 给出下一步后剩余部分可以截断
+    };
+    std::array<TX_SEGMENT, 3> d_tx_segs;
+    int d_tx_nseg, d_tx_seg;              // 段数与当前段
+    unsigned d_tx_bit;                    // 比特段中的当前比特
+    size_t d_tx_pos;                      // 当前模板（或当前比特的 data_0/data_1）中的样点位置
+    packed_bits<QUERY_LENGTH> d_tx_bits;  // 比特段的内容（Query/ACK/QueryAdjust 中最长的是 Query）
+    uint64_t d_tx_clock;                  // 已输出的样点数，即下一个输出样点的 TX 序号
+    uint64_t d_turnaround_seq;            // 已记录过延迟的 decoder 决定序号（READER_STATE::turnaround_seq）
+    int n_cw_chunk_s;     // 可截断的 CW 每次调用最多输出的样点数
+
+    tone_synth d_tones;                        // ACK 之后的多音 CW（没有额外载波时发普通 CW）
+    std::vector<float> d_freqs, d_amps;        // set_tones() 请求的参数（受 d_setlock 保护）
+    bool d_tones_changed;                      // 下一次 general_work 开始时交给 d_tones
+    READER_STATE::sptr reader_state; // 与同组 gate/tag_decoder 共享的上下文
+
+    LINK_PARAMS link;                          // 当前使用的链路参数
+    std::atomic<LINK_PROFILE> d_next_profile;  // set_link_profile() 请求的参数，下一条 Query 时生效
 
-    int d_num_sines;
-    std::vector<float> d_freqs, d_amps;
-    void gen_query_adjust_bits();
-    void crc_append(std::vector<float> & q);
-    void gen_query_bits();
-    void gen_ack_bits(const float * in);
+    void set_link(const LINK_PARAMS& l);
+    void handle_tones(const pmt::pmt_t& msg);  // "tones" 消息端口：{freqs: [...], amps: [...]}
 
-    static inline void append_vec(std::vector<float>& dst, const std::vector<float>& src) {
-        dst.insert(dst.end(), src.begin(), src.end());
+    void gen_query_adjust_bits(int updn);
+    void crc_append(packed_bits<QUERY_LENGTH> & q);
+    void gen_query_bits(int q);
+    void gen_ack_bits(const packed_bits<RN16_BITS - 1> & rn16);
+
+    // 开始一条新命令 / 追加一段 / 追加 PIE 比特段
+    void tx_begin() { d_tx_nseg = 0; d_tx_seg = 0; d_tx_bit = 0; d_tx_pos = 0; }
+    void tx_push(const std::vector<float>& wave, bool cuttable = false) { d_tx_segs[d_tx_nseg++] = { TX_WAVE, &wave, wave.size(), cuttable }; }
+    void tx_push_tones(size_t length) { d_tx_segs[d_tx_nseg++] = { TX_TONES, nullptr, length, true }; }
+    template <unsigned N>
+    void tx_push_bits(const packed_bits<N>& bits)
+    {
+        d_tx_bits.clear();
+        d_tx_bits.append(bits);
+        d_tx_segs[d_tx_nseg++] = { TX_BITS, nullptr, 0, false };
     }
+    bool tx_busy() const { return d_tx_seg < d_tx_nseg; }
+    int render(float* out, int noutput_items);   // 从游标处输出样点，返回个数
+    // 逻辑状态仍是 from 时转到 to；decoder 在此之间发布了新的决定时保留它
+    void advance_logic(GEN2_LOGIC_STATUS from, GEN2_LOGIC_STATUS to);
+    // 已加入的命令段在 TX 时间线上的结束位置随 seek 一起发布给 gate
+    void publish_seek(GATE_STATUS seek);
+    // 记录 decoder 发布 -> 生成 -> 交出第一个样点的墙钟延迟
+    void record_turnaround(uint64_t rendered, uint64_t emitted);
 public:
-    reader_impl(float sample_rate, float dac_rate, int nums_sine, std::vector<float> freq, std::vector<float> amp);
+    reader_impl(READER_STATE::sptr state, float sample_rate, float dac_rate, int nums_sine, std::vector<float> freq, std::vector<float> amp,
+                LINK_PROFILE link_profile);
     ~reader_impl();
 
     void print_results();
+
+    void set_link_profile(LINK_PROFILE link_profile) override;
+    void set_tones(const std::vector<float>& freqs, const std::vector<float>& amps) override;
+    LINK_PROFILE link_profile() const override { return d_next_profile.load(std::memory_order_relaxed); }
+    LATENCY_SUMMARY turnaround_latency(TURNAROUND path, LATENCY_STAGE stage) const override;
     
     // Where all the action really happens
-    void forecast(int noutput_items, gr_vector_int& ninput_items_required);
-
     int general_work(int noutput_items,
                      gr_vector_int& ninput_items,
                      gr_vector_const_void_star& input_items,
@@ -6,36 +6,54 @@
  */
 
 #include "tag_decoder_impl.h"
+#include "crc.h"
+#include "line_code.h"
 #include <gnuradio/io_signature.h>
+#include <algorithm>
 #include <vector>
 
 namespace gr {
 namespace reader {
 
 using input_type = gr_complex;
-using output_type = std::vector<int>;
 
-tag_decoder::sptr tag_decoder::make(float sample_rate)
+static const pmt::pmt_t SOB_KEY       = pmt::mp(BURST_SOB_KEY);
+static const pmt::pmt_t EOB_KEY       = pmt::mp(BURST_EOB_KEY);
+static const pmt::pmt_t DC_KEY        = pmt::mp(BURST_DC_KEY);
+
+tag_decoder::sptr tag_decoder::make(READER_STATE::sptr reader_state, float sample_rate, DECODER_MODE decoder_mode,
+                                    ANTI_COLLISION anti_collision_policy, int initial_q)
 {
-    std::vector<int> output_sizes;
-    output_sizes.push_back(sizeof(float));
-    output_sizes.push_back(sizeof(gr_complex));
-    return gnuradio::make_block_sptr<tag_decoder_impl>(sample_rate, output_sizes);
+    return gnuradio::make_block_sptr<tag_decoder_impl>(reader_state, sample_rate, decoder_mode,
+                                                       anti_collision_policy, initial_q);
 }
 
 /*
  * The private constructor
  */
-tag_decoder_impl::tag_decoder_impl(float sample_rate, std::vector<int> output_sizes)
+tag_decoder_impl::tag_decoder_impl(READER_STATE::sptr state, float sample_rate, DECODER_MODE decoder_mode,
+                                   ANTI_COLLISION anti_collision_policy, int initial_q)
     : gr::block("tag_decoder",
                 gr::io_signature::make(
                     1 /* min inputs */, 1 /* max inputs */, sizeof(input_type)),
-                gr::io_signature::makev(
-                    2 /* min outputs */, 2 /*max outputs */, output_sizes)),
-                s_rate(sample_rate)
+                gr::io_signature::make(0, 0, 0)),
+                s_rate(sample_rate), preamble(1), sync_quality(0), reply_detected(false), sync_start(0), data_end(0),
+                reader_state(state), n_pending_items(1), burst_seq(0), mode(decoder_mode),
+                policy(anti_collision::make(anti_collision_policy, initial_q))
 {
-    char_bits = (char *) malloc( sizeof(char) * 128);
-    n_samples_TAG_BIT = TAG_BIT_D * s_rate / pow(10,6);
+    set_link(reader_state->link);
+
+    // 第一条 Query 使用策略的初始 Q
+    reader_state->q = policy->q();
+    reader_state->reader_stats.max_slot_number = 1 << policy->q();
+
+    // 按最长的 EPC 预留网格缓冲，稳态下不再分配
+    bit_obs.resize(2 * EPC_BITS);
+    quad_obs.resize(2 * EPC_BITS);
+    soft_bits.resize(EPC_BITS);
+    alpha.resize(2 * (EPC_BITS + 1));
+    // 一个突发上最多 SOB + 4 个描述符 + EOB + 关门时刻
+    burst_tags.reserve(8);
 
 }
 
@@ -45,7 +63,58 @@ tag_decoder_impl::tag_decoder_impl(float sample_rate, std::vector<int> output_si
 tag_decoder_impl::~tag_decoder_impl() {}
 
 void tag_decoder_impl::forecast(int noutput_items, gr_vector_int& ninput_items_required) {
-    ninput_items_required[0] = noutput_items;
+    // 只在一个完整突发到齐后才被调度：突发尚未结束时要求比上次看到的多一个样点，
+    // 调度器会挂起本 block 直到 gate 继续产出
+    ninput_items_required[0] = n_pending_items;
+}
+
+int tag_decoder_impl::parse_burst(uint64_t start, int n, GATE_WINDOW& window)
+{
+    get_tags_in_range(burst_tags, 0, start, start + n);
+
+    // 第一个 SOB 之前的样点不属于任何突发
+    auto sob = std::find_if(burst_tags.begin(), burst_tags.end(),
+                            [](const tag_t& t) { return pmt::eq(t.key, SOB_KEY); });
+    if (sob == burst_tags.end())
+        return -n;
+    if (sob->offset != start)
+        return -(int) (sob->offset - start);
+
+    size_t len;
+    const uint64_t* fields = pmt::u64vector_elements(sob->value, len);
+    LINK_PROFILE profile = (LINK_PROFILE) fields[SOB_LINK];
+    window.seq = fields[SOB_SEQ];
+    window.type = (DECODER_STATUS) fields[SOB_TYPE];
+    window.link = (profile == link.profile) ? link : link_params(profile);
+    window.rx_sample = fields[SOB_RX_SAMPLE];
+    window.dc_est = gr_complex(0, 0);
+    window.n_samples = 0;
+    window.close_ns = 0;
+    window.synced = false;
+    for (const tag_t& t : burst_tags)
+    {
+        // EOB 之后是下一个突发
+        if (window.n_samples > 0 && t.offset >= start + window.n_samples)
+            break;
+        if (pmt::eq(t.key, EOB_KEY))
+        {
+            window.n_samples = t.offset - start + 1;
+            window.close_ns = pmt::u64vector_elements(t.value, len)[EOB_CLOSE_NS];
+        }
+        else if (t.offset == start && pmt::eq(t.key, DC_KEY))
+            window.dc_est = pmt::c32vector_elements(t.value, len)[0];
+    }
+
+    // gate 在 EOB 之前写入同步字段，突发到齐之后才可读
+    if (window.n_samples > 0 && fields[SOB_SYNC])
+    {
+        window.synced = true;
+        window.sync_start = field_float(fields[SOB_SYNC_START]);
+        window.sync_T = field_float(fields[SOB_SYNC_T]);
+        window.sync_quality = field_float(fields[SOB_SYNC_QUALITY]);
+        window.sync_h = gr_complex(field_float(fields[SOB_SYNC_H_RE]), field_float(fields[SOB_SYNC_H_IM]));
+    }
+    return window.n_samples;
 }
 
 int tag_decoder_impl::general_work(int noutput_items,
@@ -54,330 +123,416 @@ int tag_decoder_impl::general_work(int noutput_items,
                                    gr_vector_void_star& output_items)
 {
     auto in = static_cast<const input_type*>(input_items[0]);
-    auto out = static_cast<float*>(output_items[0]);
-    auto out_2 = static_cast<gr_complex*>(output_items[1]);
 
-    int written_sync =0;
-    int written = 0, consumed = 0;
-    int RN16_index , EPC_index;
+    // 每次处理 gate 输出的一个完整突发，窗口的描述全部来自突发标签
+    GATE_WINDOW window;
+    int n = parse_burst(nitems_read(0), ninput_items[0], window);
+    if (n < 0)
+    {
+        d_logger->warn("{} samples outside a gate burst, dropped", -n);
+        consume_each(-n);
+        return WORK_CALLED_PRODUCE;
+    }
+    if (n == 0)
+    {
+        n_pending_items = ninput_items[0] + 1;
+        consume_each(0);
+        return WORK_CALLED_PRODUCE;
+    }
+    n_pending_items = 1;
 
-    std::vector<float> RN16_samples_real;
-    std::vector<float> EPC_samples_real;
+    if (window.seq != burst_seq)
+        d_logger->warn("gate burst {} after {}, {} windows lost", window.seq, burst_seq - 1, window.seq - burst_seq);
+    burst_seq = window.seq + 1;
 
-    std::vector<gr_complex> RN16_samples_complex;
-    std::vector<gr_complex> EPC_samples_complex;
+    // reader 在新一轮开始时可能切换了链路参数，以开窗时的参数为准
+    if (window.link.profile != link.profile)
+        set_link(window.link);
 
-    std::vector<float> RN16_bits;
-    int number_of_half_bits = 0;
+    // 按窗口的线路码选择特化的解码内核，每个窗口只分支一次
+    switch (link.m)
+    {
+    case 0:  decode_window<fm0>(in, window);     break;
+    case 1:  decode_window<miller2>(in, window); break;
+    case 2:  decode_window<miller4>(in, window); break;
+    default: decode_window<miller8>(in, window); break;
+    }
 
-    std::vector<float> EPC_bits;   
+    consume_each(n);
+    return WORK_CALLED_PRODUCE;
+}
+
+template <class CODE>
+void tag_decoder_impl::decode_window(const gr_complex* in, const GATE_WINDOW& window)
+{
+    float RN16_index , EPC_index;
 
     // 解码RN16
-    if (reader_state->decoder_status == DECODER_DECODE_RN16 && ninput_items[0] >= reader_state->n_samples_to_ungate)
+    if (window.type == DECODER_DECODE_RN16)
     {
-        RN16_index = tag_sync(in,ninput_items[0]);
-        for (float j = RN16_index; j < ninput_items[0]; j += n_samples_TAG_BIT/2 )
+        RN16_index = tag_sync<CODE>(in, window);
+
+        // slot 分类：没有前导码为空 slot（gate 在这种情况下已提前关门，窗口只覆盖前导码区间）；
+        // 检测到前导码时解出 RN16，按重调制残差区分单个回复与碰撞，碰撞不发 ACK
+        SLOT_OUTCOME outcome = SLOT_EMPTY;
+        if (reply_detected)
         {
-            number_of_half_bits++;
-            int k = round(j);
-            RN16_samples_complex.push_back(in[k]);
-            if (number_of_half_bits == 2*(RN16_BITS-1)) break;
+            tag_detection<CODE>(in, window.n_samples, RN16_index, RN16_BITS-1, RN16_bits);
+            // 回复被窗口截断时同样视为碰撞
+            outcome = (RN16_bits.size() == RN16_BITS-1) ? classify_reply<CODE>(in, window.n_samples, RN16_BITS-1, RN16_bits) : SLOT_COLLISION;
         }
 
-        // RN16 bits are passed to the next block for the creation of ACK message
-        if (number_of_half_bits == 2*(RN16_BITS-1))
-        {  
+        if (outcome == SLOT_SINGLE)
+        {
+            // RN16 随 SEND_ACK 一起发布给 reader，用于生成 ACK
             GR_LOG_INFO(d_debug_logger, "RN16 DECODED");
-            RN16_bits  = tag_detection_RN16(RN16_samples_complex);
-
-            for(size_t bit=0; bit<RN16_bits.size(); bit++)
-            {
-                out[written] =  RN16_bits[bit];
-                written ++;
-            }
-            produce(0,written);
-            reader_state->gen2_logic_status = SEND_ACK;
+            reader_state->reader_stats.n_slots_single++;
+            reader_state->rn16 = RN16_bits;
+            publish_next(window, SEND_ACK);
         }
-        else // 标签没有发现前导码
-        {  
-            GR_LOG_INFO(d_debug_logger, "RN16 DECODED FAILURE");
-            reader_state->reader_stats.cur_slot_number++;
-            if(reader_state->reader_stats.cur_slot_number > reader_state->reader_stats.max_slot_number)
+        else
+        {
+            if (outcome == SLOT_EMPTY)
             {
-            reader_state->reader_stats.cur_slot_number = 1;
-            reader_state->reader_stats.unique_tags_round.push_back(reader_state->reader_stats.tag_reads.size());
-
-            reader_state->reader_stats.cur_inventory_round += 1;
-
-            //if (P_DOWN == true)
-            //  reader_state->gen2_logic_status = POWER_DOWN;
-            //else
-                reader_state->gen2_logic_status = SEND_QUERY;
+                GR_LOG_INFO(d_debug_logger, "RN16 NOT DETECTED");
+                reader_state->reader_stats.n_slots_empty++;
             }
             else
             {
-                reader_state->gen2_logic_status = SEND_QUERY_REP;
+                GR_LOG_INFO(d_debug_logger, "RN16 COLLISION");
+                reader_state->reader_stats.n_slots_collision++;
             }
+            check_termination();
+            publish_next(window, end_slot(outcome));
         }
-        consumed = reader_state->n_samples_to_ungate;
     }
     
     // 解码EPC
-    else if (reader_state->decoder_status == DECODER_DECODE_EPC && ninput_items[0] >= reader_state->n_samples_to_ungate )
+    else
     {  
+        EPC_index = tag_sync<CODE>(in, window);
 
-        //After EPC message send a query rep or query
-        reader_state->reader_stats.cur_slot_number++;
-        
-        EPC_index = tag_sync(in,ninput_items[0]);
-
-        for (int j = 0; j < ninput_items[0]; j++ )
+        // RN16 已经解出，EPC 没有回复或校验失败视为碰撞（多个标签回复了同一个 slot，或 ACK 的 RN16 有误）
+        SLOT_OUTCOME outcome = SLOT_COLLISION;
+        if (reply_detected)
         {
-            EPC_samples_complex.push_back(in[j]);
+            tag_detection<CODE>(in, window.n_samples, EPC_index, EPC_BITS-1, EPC_bits);
+        }
+        else
+        {
+            // gate 已提前关门，窗口只覆盖前导码区间
+            EPC_bits.clear();
+            GR_LOG_INFO(d_debug_logger, "EPC NOT DETECTED");
         }
-
-        EPC_bits = tag_detection_EPC(EPC_samples_complex,EPC_index);
 
         if (EPC_bits.size() == EPC_BITS - 1)
         {
-            // float to char -> use Buettner's function
-            for (int i =0; i < 128; i ++)
-            {
-                if (EPC_bits[i] == 0)
-                    char_bits[i] = '0';
-                else
-                    char_bits[i] = '1';
-            }
-            
-            if(check_crc(char_bits,128) == 1)
+            if (crc16_check(EPC_bits.data(), (EPC_BITS - 1) / 8))
             {
                 GR_LOG_INFO(d_debug_logger, "EPC DECODED");
-                if(reader_state->reader_stats.cur_slot_number > reader_state->reader_stats.max_slot_number)
-                {
-                    reader_state->reader_stats.cur_slot_number = 1;
-                    reader_state->reader_stats.unique_tags_round.push_back(reader_state->reader_stats.tag_reads.size());
-            
-                    reader_state->reader_stats.cur_inventory_round+=1;
-                    //if (P_DOWN == true)
-                    //  reader_state->gen2_logic_status = POWER_DOWN;
-                    //else
-                    reader_state->gen2_logic_status = SEND_QUERY;
-                }
-                else
-                {
-                    reader_state->gen2_logic_status = SEND_QUERY_REP;
-                }
-
+                outcome = SLOT_SINGLE;
                 reader_state->reader_stats.n_epc_correct+=1;
 
-                int result = 0;
-                for(int i = 0 ; i < 8 ; ++i)
-                {
-                    result += std::pow(2,7-i) * EPC_bits[104+i] ;
-                }
-
-                // Save part of Tag's EPC message (EPC[104:111] in decimal) + number of reads
-                std::map<int,int>::iterator it = reader_state->reader_stats.tag_reads.find(result);
-                if ( it != reader_state->reader_stats.tag_reads.end())
-                {
-                    it->second ++;
-                }
-                else
-                {
-                    reader_state->reader_stats.tag_reads[result]=1;
-                }
+                // 以完整的 96-bit EPC（跳过 16-bit PC）记录本次读取，RSSI 取信道估计的功率
+                struct timeval now;
+                gettimeofday(&now, NULL);
+                float rssi = 10 * std::log10(std::max(std::norm(h_est), 1e-20f));
+                if (reader_state->reader_stats.tag_reads.record(EPC_bits.data() + 2, now, rssi) == nullptr)
+                    GR_LOG_WARN(d_logger, "tag table full, read not recorded");
             }
             else
             {
-                if(reader_state->reader_stats.cur_slot_number > reader_state->reader_stats.max_slot_number)
-                {
-                    reader_state->reader_stats.cur_slot_number = 1;
-                    reader_state->reader_stats.cur_inventory_round+=1;
-                    //if (P_DOWN == true)
-                    //  reader_state->gen2_logic_status = POWER_DOWN;
-                    //else
-                    //  reader_state->gen2_logic_status = SEND_NAK_Q;
-                    reader_state->gen2_logic_status = SEND_QUERY;
-                }
-                else
-                {
-                    //reader_state->gen2_logic_status = SEND_NAK_QR;
-                    reader_state->gen2_logic_status = SEND_QUERY_REP;
-                }
-
                 GR_LOG_INFO(d_debug_logger, "EPC FAIL TO DECODE");
             }
         }
-        else
+        else if (reply_detected)
         {
-            GR_LOG_EMERG(d_debug_logger, "CHECK ME");  
+            // gate 在回波消失后提前关门，回复比 EPC_BITS 短
+            GR_LOG_INFO(d_debug_logger, "EPC TRUNCATED");
         }
-        consumed = reader_state->n_samples_to_ungate;
+
+        // 本 slot 结束，由防碰撞策略决定 QueryRep / QueryAdjust / Query
+        GEN2_LOGIC_STATUS next = end_slot(outcome);
+        check_termination();
+        publish_next(window, next);
     }
+}
 
-    consume_each(consumed);
-    return WORK_CALLED_PRODUCE;
+void tag_decoder_impl::publish_next(const GATE_WINDOW& window, GEN2_LOGIC_STATUS next)
+{
+    // RN16 之后只统计发 ACK 的 slot（空 slot 与碰撞没有 T2 约束），EPC 之后的下一条命令都统计
+    int path = -1;
+    if (window.type == DECODER_DECODE_EPC)
+        path = TURNAROUND_EPC_NEXT;
+    else if (next == SEND_ACK)
+        path = TURNAROUND_RN16_ACK;
+
+    uint64_t now = wall_clock_ns();
+    if (path >= 0 && window.close_ns > 0)
+        reader_state->latency.at((TURNAROUND) path, LAT_GATE_TO_DECODER).record(now - window.close_ns);
+
+    // 时间戳随决定一起发布：先写字段，再递增序号，最后以 release 写入逻辑状态
+    reader_state->turnaround_path = (window.close_ns > 0) ? path : -1;
+    reader_state->reply_close_ns = window.close_ns;
+    reader_state->decided_ns = now;
+    reader_state->turnaround_seq.fetch_add(1, std::memory_order_release);
+    reader_state->set_gen2_logic_status(next);
 }
 
-int tag_decoder_impl::tag_sync(const gr_complex * in , int size)
+void tag_decoder_impl::set_link(const LINK_PARAMS& l)
 {
-    int max_index = 0;
-    float max = 0,corr;
-    gr_complex corr2;
-    
-    // Do not have to check entire vector (not optimal)
-    for (int i=0; i < 1.5 * n_samples_TAG_BIT ; i++)
+    link = l;
+    n_samples_TAG_BIT = link.tag_bit_d() * s_rate / pow(10,6);
+    preamble.set_samples_per_bit(n_samples_TAG_BIT);
+    // 前缀和只覆盖前导码的检测区间（与 gate 的 n_samples_detect 相同），稳态下 load()/search() 不再分配
+    preamble.reserve(reply_window_samples(link, 0, n_samples_TAG_BIT));
+}
+
+GEN2_LOGIC_STATUS tag_decoder_impl::end_slot(SLOT_OUTCOME outcome)
+{
+    SLOT_DECISION decision = policy->slot_done(outcome);
+    READER_STATS& stats = reader_state->reader_stats;
+
+    if (decision.new_round)
     {
-        corr2 = gr_complex(0,0);
-        corr = 0;
-        // sync after matched filter (equivalent)
-        for (int j = 0; j < 2 * TAG_PREAMBLE_BITS; j ++)
-        {
-            corr2 = corr2 + in[ (int) (i+j*n_samples_TAG_BIT/2) ] * gr_complex(TAG_PREAMBLE[j],0);
-        }
-        corr = std::norm(corr2);
-        if (corr > max)
-        {
-            max = corr;
-            max_index = i;
-        }
+        stats.unique_tags_round.push_back(stats.tag_reads.size());
+        stats.cur_inventory_round += 1;
+        stats.cur_slot_number = 1;
+        stats.max_slot_number = 1 << decision.q;
+    }
+    else
+    {
+        stats.cur_slot_number++;
     }
 
-    // Preamble ({1,1,-1,1,-1,-1,1,-1,-1,-1,1,1} 1 2 4 7 11 12)) 
-    h_est = (in[max_index] + in[ (int) (max_index + n_samples_TAG_BIT/2) ] + in[ (int) (max_index + 3*n_samples_TAG_BIT/2) ] + in[ (int) (max_index + 6*n_samples_TAG_BIT/2)] + in[(int) (max_index + 10*n_samples_TAG_BIT/2) ] + in[ (int) (max_index + 11*n_samples_TAG_BIT/2)])/std::complex<float>(6,0);  
-
-    // Shifted received waveform by n_samples_TAG_BIT/2
-    max_index = max_index + TAG_PREAMBLE_BITS * n_samples_TAG_BIT + n_samples_TAG_BIT/2; 
-    return max_index;  
+    // 与下一条命令一起发布给 reader（调用者随后以 release 语义写入逻辑状态）
+    reader_state->q = decision.q;
+    reader_state->q_updn = decision.q_updn;
+    return decision.next;
 }
 
-std::vector<float>  tag_decoder_impl::tag_detection_RN16(std::vector<gr_complex> & RN16_samples_complex)
+void tag_decoder_impl::check_termination()
 {
-    // detection + differential decoder (since Tag uses FM0)
-    std::vector<float> tag_bits,dist;
-    float result;
-    int prev = 1;
-    // int index_T=0;
-
-    for (size_t j = 0; j < RN16_samples_complex.size()/2 ; j ++ )
+    // 终止条件判断（tag_reads 只由 decoder 修改，因此在这里检查）
+    if( (reader_state-> reader_stats.n_queries_sent.load(std::memory_order_relaxed) > MAX_NUM_QUERIES ||
+        reader_state-> reader_stats.tag_reads.size() > NUMBER_UNIQUE_TAGS) &&  
+        reader_state-> status.load(std::memory_order_relaxed) != TERMINATED) 
     {
-        result = std::real( (RN16_samples_complex[2*j] - RN16_samples_complex[2*j+1])*std::conj(h_est)); 
-
-        if (result>0) {
-            if (prev == 1)
-                tag_bits.push_back(0);
-            else
-                tag_bits.push_back(1);      
-            prev = 1;      
-        }
-        else
-        { 
-            if (prev == -1)
-                tag_bits.push_back(0);
-            else
-                tag_bits.push_back(1);      
-            prev = -1;
-        }
+        gettimeofday (&reader_state-> reader_stats.end, NULL);
+        reader_state-> status.store(TERMINATED, std::memory_order_release);
+        std::cout << "| Execution time : " << reader_state-> reader_stats.end.tv_sec - reader_state-> reader_stats.start.tv_sec << " seconds" << std::endl;
+        GR_LOG_INFO(d_logger, "Termination");
     }
-    return tag_bits;
 }
 
-
-std::vector<float>  tag_decoder_impl::tag_detection_EPC(std::vector<gr_complex> & EPC_samples_complex, int index)
+template <class CODE>
+float tag_decoder_impl::tag_sync(const gr_complex* in, const GATE_WINDOW& window)
 {
-    std::vector<float> tag_bits,dist;
-    float result=0;
-    int prev = 1;
-    
-    int number_steps = 20;
-    float min_val = n_samples_TAG_BIT/2.0 -  n_samples_TAG_BIT/2.0/100, max_val = n_samples_TAG_BIT/2.0 +  n_samples_TAG_BIT/2.0/100;
-
-    std::vector<float> energy;
-
-    energy.resize(number_steps);
-    for (int t = 0; t <number_steps; t++)
-    {  
-    for (int i =0; i <256; i++)
+    preamble_sync sync;
+    if (window.synced)
+    {
+        // gate 已在窗口开头的同一段样点上搜索过
+        sync = { window.sync_start, window.sync_T, CODE::PREAMBLE_BITS * window.sync_T, window.sync_quality, window.sync_h };
+    }
+    else
     {
-        energy[t]+= reader_state->magn_squared_samples[(int) (i * (min_val + t*(max_val-min_val)/(number_steps-1)) + index)];
+        // TRext = 1 时前导码之前还有 pilot，起点搜索范围相应后移。
+        // 搜索只用到起点范围加前导码，数据部分由 tag_detection() 直接从输入积分
+        preamble.load(in, std::min(window.n_samples, reply_window_samples(link, 0, n_samples_TAG_BIT)));
+        sync = preamble.search<CODE>((PREAMBLE_SEARCH_BITS + link.pilot_bits()) * n_samples_TAG_BIT, BLF_TOLERANCE);
     }
+    h_est = sync.h;
+    T_global = sync.T;
+    sync_quality = sync.quality;
+    reply_detected = preamble_detected(sync);
+    sync_start = sync.start;
+    d_debug_logger->debug("preamble at {}, T {}, quality {}", sync.start, sync.T, sync.quality);
+
+    // 跳过前导码，返回第一个数据比特的起点
+    return sync.start + CODE::PREAMBLE_BITS * sync.T;
+}
+
+template <class CODE, unsigned N>
+void tag_decoder_impl::tag_detection(const gr_complex* in, int size, float index, int n_bits, packed_bits<N>& tag_bits)
+{
+    // 每个比特分为 2M 个码片，按副载波符号累加前后各 M 个码片得到两个半比特的基带观测 a、c
+    // （FM0 即两个半比特的积分）。比特 1 与比特 0 分别由 a+c / a-c 的相对大小判决（见 line_code::decide）。
+    // 定时由必然出现的跳变给出 early-late 误差，逐比特修正起点与周期 T：
+    //   FM0   ：比特边界（比特起点必翻转）
+    //   Miller：半比特内相邻码片之间的副载波翻转，对本比特内的 2(M-1) 个翻转取平均
+    const int M = CODE::SUBCARRIER;
+    tag_bits.clear();
+    float T = T_global;
+    float b = index;
+    float h_norm = std::norm(h_est);
+    if (h_norm <= 0)
+        return;
+
+    // 码片边界与码片中点处相对比特起点的部分和（步进 L/2），码片积分和跨翻转 ±L/2 的积分都由它们的差得到
+    gr_complex S[4 * M + 1];
+
+    int j = 0;
+    for (; j < n_bits; j++)
+    {
+        // FM0 需要用到下一比特起点之后 T/4 的样点
+        float reach = (M == 1) ? T + T/4 : T;
+        if (b < 0 || b + reach >= size - 1)
+            break;
+
+        float L = T / CODE::CHIPS;
+        S[0] = gr_complex(0, 0);
+        for (int k = 1; k <= 4 * M; k++)
+            S[k] = S[k - 1] + integrate_samples(in, b + (k - 1) * L / 2, b + k * L / 2);
+
+        gr_complex a(0, 0), c(0, 0);
+        for (int k = 0; k < M; k++)
+        {
+            a += CODE::subcarrier(k)     * (S[2*k + 2]       - S[2*k]);
+            c += CODE::subcarrier(M + k) * (S[2*(M + k) + 2] - S[2*(M + k)]);
+        }
+        float p = std::real((a + c) * std::conj(h_est));
+        float m = std::real((a - c) * std::conj(h_est));
+        tag_bits.push_back(CODE::decide(p, m));
+
+        float scale = 1 / (h_norm * T/2);
+        bit_obs[2*j]      = std::real(a * std::conj(h_est)) * scale;
+        bit_obs[2*j + 1]  = std::real(c * std::conj(h_est)) * scale;
+        quad_obs[2*j]     = std::imag(a * std::conj(h_est)) * scale;
+        quad_obs[2*j + 1] = std::imag(c * std::conj(h_est)) * scale;
+
+        // 跳变晚了 e 个样点时，跨跳变 ±w 的积分为 2 s e h（s 为跳变前电平的符号）
+        float w = L/2;
+        float next = b + T;
+        float e;
+        if (M == 1)
+        {
+            float s = (std::real(c * std::conj(h_est)) > 0) ? 1 : -1;
+            e = -std::real(integrate_samples(in, next - w, next + w) * std::conj(h_est)) / (2 * s * h_norm);
+        }
+        else
+        {
+            float sa = (std::real(a * std::conj(h_est)) > 0) ? 1 : -1;
+            float sc = (std::real(c * std::conj(h_est)) > 0) ? 1 : -1;
+            float acc = 0;
+            for (int k = 1; k < M; k++)
+            {
+                acc += sa * CODE::subcarrier(k - 1)     * std::real((S[2*k + 1]       - S[2*k - 1])       * std::conj(h_est));
+                acc += sc * CODE::subcarrier(M + k - 1) * std::real((S[2*(M + k) + 1] - S[2*(M + k) - 1]) * std::conj(h_est));
+            }
+            e = -acc / (2 * h_norm * 2 * (M - 1));
+        }
+        e = std::max(-w, std::min(w, e));
 
+        b = next - EL_GAIN_TIMING * e;
+        T = T - EL_GAIN_PERIOD * e;
     }
-    int index_T = std::distance(energy.begin(), std::max_element(energy.begin(), energy.end()));
-    float T =  min_val + index_T*(max_val-min_val)/(number_steps-1);
 
-    // T estimated
+    d_debug_logger->debug("T drift {}", T - T_global);
     T_global = T;
+    data_end = b;
 
-    for (int j = 0; j < 128 ; j ++ )
-    {
-    result = std::real((EPC_samples_complex[ (int) (j*(2*T) + index) ] - EPC_samples_complex[ (int) (j*2*T + T + index) ])*std::conj(h_est) ); 
+    // 网格译码只针对 FM0 的两状态转移，Miller 保持硬判决
+    if (CODE::SUBCARRIER == 1 && j == n_bits && mode.load(std::memory_order_relaxed) == DECODER_MODE_VITERBI)
+        fm0_viterbi(n_bits, tag_bits);
+}
 
-    
-        if (result>0){
-        if (prev == 1)
-        tag_bits.push_back(0);
-        else
-        tag_bits.push_back(1);      
-        prev = 1;      
-    }
-    else
-    { 
-        if (prev == -1)
-        tag_bits.push_back(0);
-        else
-        tag_bits.push_back(1);      
-        prev = -1;    
+template <class CODE, unsigned N>
+SLOT_OUTCOME tag_decoder_impl::classify_reply(const gr_complex* in, int size, int n_bits, const packed_bits<N>& tag_bits)
+{
+    // 按判决比特从前导码结束时的编码器状态重新调制出半比特电平，与观测比较：
+    // 单个标签时残差只有噪声；碰撞时其它标签的回波（不同的数据、相位、定时）留在残差里，
+    // 同相分量破坏线路码的跳变规律，正交分量则完全不能被 h_est 解释
+    float residual = 0;
+    BASEBAND_STATE state = CODE::preamble_end();
+    for (int j = 0; j < n_bits; j++)
+    {
+        int ea, ec;
+        CODE::encode(tag_bits[j], state, ea, ec);
+        residual += (bit_obs[2*j] - ea) * (bit_obs[2*j] - ea) + quad_obs[2*j] * quad_obs[2*j]
+                  + (bit_obs[2*j + 1] - ec) * (bit_obs[2*j + 1] - ec) + quad_obs[2*j + 1] * quad_obs[2*j + 1];
     }
+    residual /= 2 * n_bits;
+
+    // 噪声底：回复（含 pilot）之前和 dummy bit 之后的样点（与 bit_obs 同一归一化：每个半比特的信号能量为 1）
+    float T = T_global;
+    float head = std::max(0.0f, sync_start - link.pilot_bits() * T - T/4);
+    float tail = std::min((float) size - 1, data_end + T + T/4);
+    float n_noise = head + (size - 1 - tail);
+    float noise = -1;
+    if (n_noise >= T/2)
+    {
+        float e = energy_samples(in, 0, head) + energy_samples(in, tail, size - 1);
+        noise = e / n_noise / (std::norm(h_est) * T/2);
     }
-    return tag_bits;
+
+    // 干扰能量（残差减去噪声）相对信号超过 COLLISION_ISR，且残差明显高于噪声底时判为碰撞；
+    // 低 SNR 下单个标签的残差由噪声主导，只靠前一个条件会误判
+    float excess = residual - std::max(noise, 0.0f);
+    bool collided = excess > COLLISION_ISR && (noise < 0 || residual > COLLISION_NOISE_RATIO * noise);
+
+    d_debug_logger->debug("residual {}, noise {}", residual, noise);
+    return collided ? SLOT_COLLISION : SLOT_SINGLE;
 }
 
-/* Function adapted from https://www.cgran.org/wiki/Gen2 */
-int tag_decoder_impl::check_crc(char * bits, int num_bits)
+template <unsigned N>
+void tag_decoder_impl::fm0_viterbi(int n_bits, packed_bits<N>& tag_bits)
 {
-    unsigned short i, j;
-    unsigned short crc_16, rcvd_crc;
-    unsigned char * data;
-    int num_bytes = num_bits / 8;
-    data = (unsigned char* )malloc(num_bytes );
-    int mask;
-
-    for(i = 0; i < num_bytes; i++)
+    // 状态为上一比特结束时的电平 l（0: +1, 1: -1）。FM0 在比特起点必翻转：
+    //   比特 1：两个半比特为 (-l, -l)，结束电平 -l
+    //   比特 0：两个半比特为 (-l, +l)，结束电平  l
+    // 分支度量取观测与期望波形的相关；前导码以高电平结束，故初始状态为 +1。
+    // 前向 + 后向 max-log 递推得到每比特的 LLR，按 1/sigma^2 缩放。
+    const float NEG_INF = -1e30f;
+    auto level = [](int s) { return s == 0 ? 1.0f : -1.0f; };
+
+    alpha[0] = 0;
+    alpha[1] = NEG_INF;
+    for (int j = 0; j < n_bits; j++)
     {
-        mask = 0x80;
-        data[i] = 0;
-        for(j = 0; j < 8; j++)
+        float ra = bit_obs[2*j], rc = bit_obs[2*j + 1];
+        float* cur = &alpha[2*j];
+        float* nxt = &alpha[2*j + 2];
+        for (int q = 0; q < 2; q++)
         {
-            if (bits[(i * 8) + j] == '1'){
-            data[i] = data[i] | mask;
-        }
-        mask = mask >> 1;
+            float lq = level(q);
+            // 到达 q：从 q 发 0（期望 (-lq, lq)），或从 1-q 发 1（期望 (lq, lq)）
+            float via0 = cur[q]     + (-lq * ra + lq * rc);
+            float via1 = cur[1 - q] + ( lq * ra + lq * rc);
+            nxt[q] = std::max(via0, via1);
         }
     }
-    rcvd_crc = (data[num_bytes - 2] << 8) + data[num_bytes -1];
 
-    crc_16 = 0xFFFF; 
-    for (i=0; i < num_bytes - 2; i++)
+    float beta[2] = { 0, 0 };
+    float noise = 0;
+    for (int j = n_bits - 1; j >= 0; j--)
     {
-        crc_16^=data[i] << 8;
-        for (j=0;j<8;j++)
+        float ra = bit_obs[2*j], rc = bit_obs[2*j + 1];
+        const float* cur = &alpha[2*j];
+        float best1 = NEG_INF, best0 = NEG_INF, prev_beta[2];
+        for (int p = 0; p < 2; p++)
         {
-            if (crc_16&0x8000)
-            {
-            crc_16 <<= 1;
-            crc_16 ^= 0x1021;
-            }
-            else
-            crc_16 <<= 1;
+            float lp = level(p);
+            float g1 = -lp * ra - lp * rc;   // 比特 1，到达 1-p
+            float g0 = -lp * ra + lp * rc;   // 比特 0，到达 p
+            best1 = std::max(best1, cur[p] + g1 + beta[1 - p]);
+            best0 = std::max(best0, cur[p] + g0 + beta[p]);
+            prev_beta[p] = std::max(g1 + beta[1 - p], g0 + beta[p]);
         }
+        beta[0] = prev_beta[0];
+        beta[1] = prev_beta[1];
+        soft_bits[j] = best1 - best0;
+        noise += (std::abs(ra) - 1) * (std::abs(ra) - 1) + (std::abs(rc) - 1) * (std::abs(rc) - 1);
     }
-    crc_16 = ~crc_16;
 
-    if(rcvd_crc != crc_16)
-        return -1;
-    else
-        return 1;
+    // 相关度量对应的对数似然为 r*x / sigma^2
+    float sigma2 = std::max(noise / (2 * n_bits), 1e-3f);
+    tag_bits.clear();
+    for (int j = 0; j < n_bits; j++)
+    {
+        soft_bits[j] /= sigma2;
+        tag_bits.push_back(soft_bits[j] > 0);
+    }
 }
+
 } /* namespace reader */
 } /* namespace gr */
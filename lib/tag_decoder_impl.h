@@ -8,6 +8,8 @@
 #ifndef INCLUDED_READER_TAG_DECODER_IMPL_H
 #define INCLUDED_READER_TAG_DECODER_IMPL_H
 
+#include "anti_collision.h"
+#include "preamble_detector.h"
 #include <gnuradio/reader/tag_decoder.h>
 #include <vector>
 
@@ -18,22 +20,54 @@ class tag_decoder_impl : public tag_decoder
 {
 private:
     float n_samples_TAG_BIT;                 // 每个Tag比特对应的采样点数（samples/bit）
+    LINK_PARAMS link;                        // 当前窗口的链路参数（gate 随窗口发布）
     int s_rate;                              // 采样率 Hz
     std::vector<float> pulse_bit;            // 比特模板/相关模板（用于检测或匹配滤波）
-    float T_global;                          // 全局时间/周期参数（用于定时/同步）
+    float T_global;                          // 估计的 tag 比特周期（samples，随比特跟踪更新）
     gr_complex h_est;                        // 信道估计复系数（幅度+相位）
-    char* char_bits;                         // 解码后的硬判决比特缓存（0/1 或 '0'/'1'）
+    preamble_detector preamble;              // 前导码匹配滤波器
+    float sync_quality;                      // 最近一次前导码同步的归一化相关质量 [0,1]
+    bool reply_detected;                     // 最近一次同步是否检测到前导码（否则为空 slot / 无回复）
+    float sync_start;                        // 最近一次同步的前导码起点（samples）
+    float data_end;                          // 最近一次判决结束处（dummy bit 起点，samples）
+    READER_STATE::sptr reader_state;         // 与同组 gate/reader 共享的上下文
+    int n_pending_items;                     // 突发未到齐时，下次调度所需的最少输入样点数
+    std::vector<tag_t> burst_tags;           // get_tags_in_range() 的结果（复用容量）
+    uint64_t burst_seq;                      // 下一个突发的预期序号
+    packed_bits<RN16_BITS - 1> RN16_bits;    // 解出的 RN16（不含 dummy bit）
+    packed_bits<EPC_BITS - 1> EPC_bits;      // 解出的 PC + EPC + CRC16（不含 dummy bit）
+    std::atomic<DECODER_MODE> mode;          // FM0 判决方式（可由 set_decoder_mode 在其它线程修改；Miller 始终硬判决）
+    std::vector<float> bit_obs;              // 每比特两个半比特（Miller 为解副载波后）在 h_est 上的归一化投影（无噪声时为 ±1）
+    std::vector<float> quad_obs;             // 同上，正交分量（单个标签无噪声时为 0）
+    std::vector<float> soft_bits;            // 每比特的 LLR（>0 判 1），Viterbi 模式下有效
+    std::vector<float> alpha;                // 网格前向度量，2 个状态 x (n_bits + 1)
+    anti_collision::uptr policy;             // 防碰撞策略：按 slot 结果决定下一条命令与 Q
 
-    std::vector<float> tag_detection_EPC(std::vector<gr_complex>& EPC_samples_complex, int index); // 从EPC窗口解码并输出软指标/幅度序列
-    std::vector<float> tag_detection_RN16(std::vector<gr_complex>& RN16_samples_complex);          // 从RN16窗口解码并输出软指标/幅度序列
-    int tag_sync(const gr_complex* in, int size);                                                  // 在输入采样中找到Tag回复起点并返回索引
-    int check_crc(char* bits, int num_bits);                                                       // 对bit流做CRC校验并返回是否通过
+    int parse_burst(uint64_t start, int n, GATE_WINDOW& window);                                   // 解析从 start 起的突发：返回长度，0 为未到齐，负数为需丢弃的样点数
+    template <class CODE>
+    void decode_window(const gr_complex* in, const GATE_WINDOW& window);                         // 按线路码 CODE 解码一个窗口并推进 Gen2 逻辑
+    template <class CODE, unsigned N>
+    void tag_detection(const gr_complex* in, int size, float index, int n_bits, packed_bits<N>& tag_bits); // 从比特起点 index 起判决 n_bits 个比特，同时跟踪定时
+    template <class CODE, unsigned N>
+    SLOT_OUTCOME classify_reply(const gr_complex* in, int size, int n_bits, const packed_bits<N>& tag_bits); // 按重调制残差与噪声底区分单个回复 / 碰撞
+    template <unsigned N>
+    void fm0_viterbi(int n_bits, packed_bits<N>& tag_bits);                                        // 在 bit_obs 上做两状态 max-log 网格译码，输出判决与 soft_bits
+    template <class CODE>
+    float tag_sync(const gr_complex* in, const GATE_WINDOW& window);                               // 取 gate 的同步结果（没有时自己搜索），返回第一个数据比特的（亚采样）索引
+    void check_termination();                                                                      // 检查停止条件（查询次数/唯一标签数）
+    GEN2_LOGIC_STATUS end_slot(SLOT_OUTCOME outcome);                                              // 结束当前 slot：更新轮次/slot 统计，返回下一条命令
+    void publish_next(const GATE_WINDOW& window, GEN2_LOGIC_STATUS next);                          // 记录关门 -> 解完的延迟，随时间戳发布下一条命令
+    void set_link(const LINK_PARAMS& l);                                                           // 按链路参数换算 tag 比特周期
 
 
 public:
-    tag_decoder_impl(float sample_rate, std::vector<int> output_sizes);
+    tag_decoder_impl(READER_STATE::sptr state, float sample_rate, DECODER_MODE decoder_mode,
+                     ANTI_COLLISION anti_collision_policy, int initial_q);
     ~tag_decoder_impl();
 
+    void set_decoder_mode(DECODER_MODE decoder_mode) override { mode.store(decoder_mode, std::memory_order_relaxed); }
+    DECODER_MODE decoder_mode() const override { return mode.load(std::memory_order_relaxed); }
+
     // Where all the action really happens
     void forecast(int noutput_items, gr_vector_int& ninput_items_required);
 
@@ -0,0 +1,389 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "tag_emulator_impl.h"
+#include "crc.h"
+#include "line_code.h"
+#include <gnuradio/io_signature.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace gr {
+namespace reader {
+
+using input_type = float;
+using output_type = gr_complex;
+
+// 载波电平判决门限（reader 输出的载波幅度为 0/1；extra CW 的多音叠加不应跌破该门限）
+static const float CARRIER_THRESHOLD = 0.5;
+// 载波中断超过该时长（us）视为掉电
+static const int POWER_DOWN_GAP_D = 1000;
+
+tag_emulator::sptr tag_emulator::make(float sample_rate, int n_tags, float blf_error, float snr_db,
+                                      float amplitude, float phase, gr_complex dc_offset,
+                                      float t1_jitter_us, int seed)
+{
+    return gnuradio::make_block_sptr<tag_emulator_impl>(sample_rate, n_tags, blf_error, snr_db,
+                                                        amplitude, phase, dc_offset, t1_jitter_us, seed);
+}
+
+/*
+ * The private constructor
+ */
+tag_emulator_impl::tag_emulator_impl(float sample_rate, int n_tags, float blf_error, float snr_db,
+                                     float amplitude, float phase, gr_complex dc_offset,
+                                     float t1_jitter_us, int seed)
+    : gr::sync_block("tag_emulator",
+                     gr::io_signature::make(
+                         1 /* min inputs */, 1 /* max inputs */, sizeof(input_type)),
+                     gr::io_signature::make(
+                         1 /* min outputs */, 1 /*max outputs */, sizeof(output_type))),
+    s_rate(sample_rate), blf_error(blf_error), h(std::polar(amplitude, phase)), dc_offset(dc_offset),
+    t1_jitter(t1_jitter_us * sample_rate / pow(10,6)), noise_sigma(0), rng(seed), gauss(0, 1),
+    n_active(0), replies_sent(0), tags_read(0),
+    t(0), prev_high(true), in_frame(false), last_rise(0), last_fall(0), rtcal(0), trcal(0),
+    n_symbols(0), n_cmd_bits(0), blf_link(link_params(LINK_BLF40_FM0).blf() * (1 + blf_error)),
+    m_link(0), trext_link(0)
+{
+    if (sample_rate <= 0)
+        throw std::invalid_argument("tag_emulator: sample_rate must be > 0");
+    if (n_tags < 1)
+        throw std::invalid_argument("tag_emulator: n_tags must be >= 1");
+
+    set_snr_db(snr_db);
+
+    // EPC 回复 = PC（长度 6 个字，其余为 0）+ 随机 96-bit EPC + CRC16
+    tags.resize(n_tags);
+    for (VIRTUAL_TAG& tag : tags)
+    {
+        uint8_t bytes[(EPC_BITS - 1) / 8] = { 0x30, 0x00 };
+        for (int i = 2; i < (EPC_BITS - 1) / 8 - 2; i++)
+            bytes[i] = rng() & 0xFF;
+        uint16_t crc = crc16(bytes, (EPC_BITS - 1) / 8 - 2);
+        bytes[(EPC_BITS - 1) / 8 - 2] = crc >> 8;
+        bytes[(EPC_BITS - 1) / 8 - 1] = crc & 0xFF;
+
+        tag.epc.clear();
+        for (int i = 0; i < EPC_BITS - 1; i++)
+            tag.epc.push_back((bytes[i / 8] >> (7 - i % 8)) & 1);
+    }
+    power_down();
+
+    // 同一条命令最多让每个标签回复一次，按标签数预留回波槽位
+    replies.resize(n_tags);
+    for (ACTIVE_REPLY& r : replies)
+        r.chips.reserve(2 * 8 * (TREXT_PILOT_BITS + MILLER_PREAMBLE_BITS + EPC_BITS));
+}
+
+/*
+ * Our virtual destructor.
+ */
+tag_emulator_impl::~tag_emulator_impl() {}
+
+void tag_emulator_impl::set_snr_db(float snr_db)
+{
+    // SNR = |h|^2 / (2 sigma^2)
+    noise_sigma.store(std::abs(h) / std::sqrt(2.0f) * std::pow(10.0f, -snr_db / 20), std::memory_order_relaxed);
+}
+
+int tag_emulator_impl::work(int noutput_items,
+                            gr_vector_const_void_star& input_items,
+                            gr_vector_void_star& output_items)
+{
+    auto in = static_cast<const input_type*>(input_items[0]);
+    auto out = static_cast<output_type*>(output_items[0]);
+    float sigma = noise_sigma.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < noutput_items; i++)
+    {
+        pie_edge(in[i] > CARRIER_THRESHOLD);
+
+        // 叠加所有正在回复的标签（多个标签同时回复即为碰撞）
+        float s = 0;
+        for (int k = 0; k < n_active;)
+        {
+            ACTIVE_REPLY& r = replies[k];
+            if (t >= r.start)
+            {
+                size_t idx = (size_t) ((t - r.start) / r.chip);
+                if (idx >= r.chips.size())
+                {
+                    std::swap(replies[k], replies[--n_active]);
+                    continue;
+                }
+                s += r.chips[idx];
+            }
+            k++;
+        }
+
+        out[i] = in[i] * (dc_offset + h * s) + gr_complex(gauss(rng), gauss(rng)) * sigma;
+        t++;
+    }
+
+    return noutput_items;
+}
+
+void tag_emulator_impl::pie_edge(bool high)
+{
+    if (high && !prev_high)
+    {
+        if (in_frame)
+        {
+            // 相邻上升沿之间为一个 PIE 符号：data-0、RTcal、（Query 才有的）TRcal，之后是数据比特
+            float len = t - last_rise;
+            n_symbols++;
+            if (n_symbols == 2)
+                rtcal = len;
+            else if (n_symbols == 3 && len > 1.1f * rtcal)
+                trcal = len;
+            else if (n_symbols > 2)
+            {
+                cmd_bits.push_back(len > rtcal / 2);
+                n_cmd_bits++;
+            }
+        }
+        else if (t - last_fall < POWER_DOWN_GAP_D * s_rate / pow(10,6))
+        {
+            // 连续载波之后的第一个低电平为 delimiter，其后的上升沿是 data-0 的起点
+            in_frame = true;
+            n_symbols = 0;
+            n_cmd_bits = 0;
+            cmd_bits.clear();
+            rtcal = trcal = 0;
+        }
+        last_rise = t;
+    }
+    else if (!high && prev_high)
+    {
+        last_fall = t;
+    }
+    else if (high && in_frame)
+    {
+        // 高电平持续超过最长的符号：命令结束于最后一个上升沿。RTcal 之后的第一个符号可能是
+        // TRcal（<= 3 RTcal），其后只有数据比特（< RTcal）；T1 >= RTcal，判决不会晚于回复起点
+        float limit = (rtcal <= 0) ? POWER_DOWN_GAP_D * s_rate / pow(10,6) : (n_symbols >= 3) ? rtcal : 3 * rtcal;
+        if (t - last_rise > limit)
+        {
+            in_frame = false;
+            if (rtcal > 0)
+                process_command(last_rise);
+        }
+    }
+    else if (!high && t - last_fall == (uint64_t) (POWER_DOWN_GAP_D * s_rate / pow(10,6)))
+    {
+        in_frame = false;
+        power_down();
+    }
+    prev_high = high;
+}
+
+void tag_emulator_impl::power_down()
+{
+    for (VIRTUAL_TAG& tag : tags)
+    {
+        tag.state = TAG_READY;
+        tag.flag = false;
+        tag.read = false;
+        tag.q = 0;
+        tag.slot = 0;
+    }
+    tags_read.store(0, std::memory_order_relaxed);
+}
+
+void tag_emulator_impl::process_command(uint64_t end)
+{
+    int n = n_cmd_bits;
+
+    // Query: 1000 DR M(2) TRext Sel(2) Session(2) Target Q(4) CRC-5
+    if (n == QUERY_LENGTH && cmd_bits.field(0, 4) == 0x8)
+    {
+        if (crc5(cmd_bits.data(), QUERY_LENGTH - 5) != cmd_bits.field(QUERY_LENGTH - 5, 5))
+            return;
+
+        // BLF = DR / TRcal，DR = 8 或 64/3；M 与 TRext 决定之后回复的线路码与 pilot
+        if (trcal > 0)
+            blf_link = (cmd_bits[4] ? 64.0f / 3 : 8.0f) * s_rate / trcal * (1 + blf_error);
+        m_link = cmd_bits.field(5, 2);
+        trext_link = cmd_bits[7];
+
+        bool target = cmd_bits[12];
+        int q = cmd_bits.field(13, 4);
+        for (VIRTUAL_TAG& tag : tags)
+        {
+            if (tag.state == TAG_ACKNOWLEDGED)
+                tag.flag = !tag.flag;
+            if (tag.flag != target)
+            {
+                tag.state = TAG_READY;
+                continue;
+            }
+            tag.q = q;
+            draw_slot(tag, end);
+        }
+    }
+    // QueryRep: 00 Session(2)
+    else if (n == 4 && cmd_bits.field(0, 2) == 0)
+    {
+        for (VIRTUAL_TAG& tag : tags)
+        {
+            if (tag.state == TAG_ACKNOWLEDGED)
+            {
+                tag.flag = !tag.flag;
+                tag.state = TAG_READY;
+            }
+            else if (tag.state == TAG_REPLY)
+            {
+                // 回复了 RN16 却没有收到 ACK：退出本轮
+                tag.state = TAG_ARBITRATE;
+                tag.slot = 0x7FFF;
+            }
+            else if (tag.state == TAG_ARBITRATE)
+            {
+                tag.slot = (tag.slot - 1) & 0x7FFF;
+                if (tag.slot == 0)
+                    reply_rn16(tag, end);
+            }
+        }
+    }
+    // QueryAdjust: 1001 Session(2) UpDn(3)
+    else if (n == QUERY_ADJUST_LENGTH && cmd_bits.field(0, 4) == 0x9)
+    {
+        int updn = cmd_bits.field(6, 3);
+        if (updn != 0 && updn != 3 && updn != 6)
+            return;
+
+        for (VIRTUAL_TAG& tag : tags)
+        {
+            if (tag.state == TAG_ACKNOWLEDGED)
+            {
+                tag.flag = !tag.flag;
+                tag.state = TAG_READY;
+            }
+            else if (tag.state == TAG_ARBITRATE || tag.state == TAG_REPLY)
+            {
+                if (updn == 6) tag.q = std::min(tag.q + 1, MAX_Q);
+                if (updn == 3) tag.q = std::max(tag.q - 1, 0);
+                draw_slot(tag, end);
+            }
+        }
+    }
+    // ACK: 01 RN16
+    else if (n == ACK_LENGTH && cmd_bits.field(0, 2) == 0x1)
+    {
+        uint32_t rn16 = cmd_bits.field(2, RN16_BITS - 1);
+        for (VIRTUAL_TAG& tag : tags)
+        {
+            if (tag.state != TAG_REPLY && tag.state != TAG_ACKNOWLEDGED)
+                continue;
+            if (tag.rn16.field(0, RN16_BITS - 1) != rn16)
+            {
+                tag.state = TAG_ARBITRATE;
+                continue;
+            }
+            tag.state = TAG_ACKNOWLEDGED;
+            backscatter(tag.epc, end);
+            if (!tag.read)
+            {
+                tag.read = true;
+                tags_read.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    // NAK: 11000000
+    else if (n == 8 && cmd_bits.field(0, 8) == 0xC0)
+    {
+        for (VIRTUAL_TAG& tag : tags)
+            if (tag.state == TAG_REPLY || tag.state == TAG_ACKNOWLEDGED)
+                tag.state = TAG_ARBITRATE;
+    }
+}
+
+void tag_emulator_impl::draw_slot(VIRTUAL_TAG& tag, uint64_t end)
+{
+    tag.slot = rng() & ((1u << tag.q) - 1);
+    if (tag.slot == 0)
+        reply_rn16(tag, end);
+    else
+        tag.state = TAG_ARBITRATE;
+}
+
+void tag_emulator_impl::reply_rn16(VIRTUAL_TAG& tag, uint64_t end)
+{
+    uint32_t rn16 = rng() & 0xFFFF;
+    tag.rn16.clear();
+    for (int i = RN16_BITS - 2; i >= 0; i--)
+        tag.rn16.push_back((rn16 >> i) & 1);
+
+    tag.state = TAG_REPLY;
+    backscatter(tag.rn16, end);
+}
+
+template <unsigned N>
+void tag_emulator_impl::backscatter(const packed_bits<N>& bits, uint64_t end)
+{
+    if (n_active == (int) replies.size())
+        return;
+    ACTIVE_REPLY& r = replies[n_active++];
+
+    // T1 = max(RTcal, 10 / BLF)，加上均匀抖动
+    float T = s_rate / blf_link;
+    float T1 = std::max(rtcal, 10 * T);
+    if (t1_jitter > 0)
+        T1 += std::uniform_real_distribution<float>(-t1_jitter, t1_jitter)(rng);
+    r.start = std::max(t, end + (uint64_t) std::max(0.0f, T1));
+
+    // 码片长度为半个 BLF 周期，与 M 无关（Miller-M 的一个比特为 2M 个码片）
+    r.chip = T / 2;
+    switch (m_link)
+    {
+    case 0:  modulate<fm0>(bits, r);     break;
+    case 1:  modulate<miller2>(bits, r); break;
+    case 2:  modulate<miller4>(bits, r); break;
+    default: modulate<miller8>(bits, r); break;
+    }
+    replies_sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <class CODE, unsigned N>
+void tag_emulator_impl::modulate(const packed_bits<N>& bits, ACTIVE_REPLY& r)
+{
+    // 每个半比特的基带电平展开为 M 个码片，乘以副载波符号
+    r.chips.clear();
+    auto push_half = [&r](int level, int first_chip) {
+        for (int k = 0; k < CODE::SUBCARRIER; k++)
+            r.chips.push_back(level * CODE::subcarrier(first_chip + k));
+    };
+
+    // TRext = 1：pilot（全 0）
+    if (trext_link)
+    {
+        BASEBAND_STATE s = CODE::pilot_state();
+        for (int i = 0; i < TREXT_PILOT_BITS; i++)
+        {
+            int a, c;
+            CODE::encode(0, s, a, c);
+            push_half(a, 0);
+            push_half(c, CODE::SUBCARRIER);
+        }
+    }
+
+    // 前导码，之后按编码器状态机编码数据与 dummy 1
+    const auto& preamble = CODE::preamble_halves();
+    for (int k = 0; k < 2 * CODE::PREAMBLE_BITS; k++)
+        push_half(preamble[k], (k % 2) * CODE::SUBCARRIER);
+    BASEBAND_STATE s = CODE::preamble_end();
+    for (unsigned i = 0; i <= bits.size(); i++)
+    {
+        int a, c;
+        CODE::encode((i < bits.size()) ? bits[i] : 1, s, a, c);
+        push_half(a, 0);
+        push_half(c, CODE::SUBCARRIER);
+    }
+}
+
+} /* namespace reader */
+} /* namespace gr */
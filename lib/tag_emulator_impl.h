@@ -0,0 +1,97 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_TAG_EMULATOR_IMPL_H
+#define INCLUDED_READER_TAG_EMULATOR_IMPL_H
+
+#include <gnuradio/reader/tag_emulator.h>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+class tag_emulator_impl : public tag_emulator
+{
+private:
+    // 虚拟标签（只建模 Gen2 盘存相关的状态；所有 session 共用一个 inventoried 标志）
+    enum TAG_STATE { TAG_READY, TAG_ARBITRATE, TAG_REPLY, TAG_ACKNOWLEDGED };
+    struct VIRTUAL_TAG
+    {
+        TAG_STATE state;
+        bool flag;                          // inventoried 标志：false = A，true = B
+        bool read;                          // 本次上电以来是否被 ACK 过
+        int q;                              // 当前轮次的 Q
+        uint32_t slot;                      // 15-bit slot 计数器
+        packed_bits<RN16_BITS - 1> rn16;    // 最近一次回复的 RN16
+        packed_bits<EPC_BITS - 1> epc;      // PC + EPC + CRC16
+    };
+
+    // 正在发送的一段回波（FM0 或 Miller 副载波）
+    struct ACTIVE_REPLY
+    {
+        uint64_t start;                     // 第一个码片的起点（样点）
+        float chip;                         // 码片长度（samples），FM0 为半比特，Miller 为半个副载波周期
+        std::vector<int8_t> chips;          // 码片电平 ±1：pilot + 前导码 + 数据 + dummy 1
+    };
+
+    float s_rate;                           // 采样率 Hz
+    float blf_error;                        // BLF 相对偏差
+    gr_complex h;                           // 回波复幅度 amplitude * e^{j phase}
+    gr_complex dc_offset;                   // 载波泄漏
+    float t1_jitter;                        // T1 抖动范围（samples）
+    std::atomic<float> noise_sigma;         // 每个实/虚分量的噪声标准差
+
+    std::mt19937 rng;
+    std::normal_distribution<float> gauss;
+    std::vector<VIRTUAL_TAG> tags;
+    std::vector<ACTIVE_REPLY> replies;      // 预分配 n_tags 个槽位，前 n_active 个有效
+    int n_active;
+    std::atomic<int> replies_sent, tags_read;
+
+    // PIE 解码状态
+    uint64_t t;                             // 当前样点序号
+    bool prev_high, in_frame;
+    uint64_t last_rise, last_fall;
+    float rtcal, trcal;                     // 本帧测得的 RTcal / TRcal（samples），trcal 只在 Query 前导码里出现
+    int n_symbols;                          // 本帧已收到的符号数（含 data-0、RTcal、TRcal）
+    int n_cmd_bits;                         // 本帧已解出的命令比特数
+    packed_bits<QUERY_LENGTH> cmd_bits;     // 命令比特（最长的是 Query）
+    float blf_link;                         // 最近一条 Query 指定的 BLF（Hz，已含 blf_error）
+    int m_link, trext_link;                 // 最近一条 Query 指定的 M 与 TRext
+
+    void pie_edge(bool high);                                       // 处理一个样点的载波电平
+    void process_command(uint64_t end);                             // 按命令比特驱动所有标签
+    void power_down();                                              // 载波中断：所有标签复位
+    template <unsigned N>
+    void backscatter(const packed_bits<N>& bits, uint64_t end);     // 在命令结束后 T1 处安排一段回波
+    template <class CODE, unsigned N>
+    void modulate(const packed_bits<N>& bits, ACTIVE_REPLY& r);     // 按线路码 CODE 生成回波的码片序列
+    void reply_rn16(VIRTUAL_TAG& tag, uint64_t end);                // 新的 RN16 并回复
+    void draw_slot(VIRTUAL_TAG& tag, uint64_t end);                 // 按 tag.q 重抽 slot，为 0 时回复
+
+public:
+    tag_emulator_impl(float sample_rate, int n_tags, float blf_error, float snr_db,
+                      float amplitude, float phase, gr_complex dc_offset,
+                      float t1_jitter_us, int seed);
+    ~tag_emulator_impl();
+
+    void set_snr_db(float snr_db) override;
+    int n_replies() const override { return replies_sent.load(std::memory_order_relaxed); }
+    int n_inventoried() const override { return tags_read.load(std::memory_order_relaxed); }
+
+    int work(int noutput_items,
+             gr_vector_const_void_star& input_items,
+             gr_vector_void_star& output_items);
+};
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_TAG_EMULATOR_IMPL_H */
@@ -0,0 +1,81 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 mzssbqd.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <gnuradio/reader/tag_table.h>
+#include <cstring>
+
+namespace gr {
+namespace reader {
+
+    tag_table::tag_table(size_t max_tags)
+    {
+        reset(max_tags);
+    }
+
+    void tag_table::reset(size_t max_tags)
+    {
+        size_t n_slots = 1;
+        while (n_slots < 2 * max_tags) n_slots <<= 1;
+
+        d_slots.assign(n_slots, TAG_ENTRY());
+        d_mask = n_slots - 1;
+        d_max_tags = max_tags;
+        d_size = 0;
+        d_dropped = 0;
+    }
+
+    void tag_table::clear()
+    {
+        for (TAG_ENTRY& e : d_slots) e.n_reads = 0;
+        d_size = 0;
+        d_dropped = 0;
+    }
+
+    size_t tag_table::probe(const uint8_t* epc) const
+    {
+        // 96-bit 键拆成 64 + 32 位做乘法混合（EPC 常有大段相同前缀，低位不能直接当下标）
+        uint64_t lo;
+        uint32_t hi;
+        std::memcpy(&lo, epc, 8);
+        std::memcpy(&hi, epc + 8, 4);
+        uint64_t h = (lo ^ ((uint64_t) hi << 32 | hi)) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+
+        size_t i = h & d_mask;
+        while (d_slots[i].n_reads && std::memcmp(d_slots[i].epc.data(), epc, TAG_EPC_BYTES) != 0)
+            i = (i + 1) & d_mask;
+        return i;
+    }
+
+    TAG_ENTRY* tag_table::record(const uint8_t* epc, const struct timeval& now, float rssi)
+    {
+        TAG_ENTRY& e = d_slots[probe(epc)];
+        if (e.n_reads == 0)
+        {
+            if (d_size >= d_max_tags)
+            {
+                d_dropped++;
+                return nullptr;
+            }
+            std::memcpy(e.epc.data(), epc, TAG_EPC_BYTES);
+            e.first_seen = now;
+            d_size++;
+        }
+        e.n_reads++;
+        e.last_seen = now;
+        e.last_rssi = rssi;
+        return &e;
+    }
+
+    const TAG_ENTRY* tag_table::find(const uint8_t* epc) const
+    {
+        const TAG_ENTRY& e = d_slots[probe(epc)];
+        return e.n_reads ? &e : nullptr;
+    }
+
+} // namespace reader
+} // namespace gr
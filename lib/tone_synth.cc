@@ -0,0 +1,76 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "tone_synth.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace gr {
+namespace reader {
+
+static const double TWO_PI = 2.0 * M_PI;
+
+tone_synth::tone_synth(double sample_rate) : d_rate(sample_rate), d_base(1) {}
+
+void tone_synth::set_tones(const std::vector<float>& freqs, const std::vector<float>& amps)
+{
+    if (freqs.size() != amps.size())
+        throw std::invalid_argument("tone_synth: freqs and amps must have the same length");
+
+    // resize() 把新增的路值初始化（相位为 0），已有的路保留相位
+    d_tones.resize(freqs.size());
+    d_base = 1;
+    for (size_t k = 0; k < d_tones.size(); k++)
+    {
+        TONE& t = d_tones[k];
+        t.inc = TWO_PI * freqs[k] / d_rate;
+        t.amp = amps[k];
+        for (int j = 0; j < BLOCK; j++)
+        {
+            double p = std::remainder(j * t.inc, TWO_PI);
+            t.lane_re[j] = std::cos(p);
+            t.lane_im[j] = std::sin(p);
+        }
+        t.step = std::polar(1.0f, (float) std::remainder(BLOCK * t.inc, TWO_PI));
+        d_base -= amps[k];
+    }
+}
+
+void tone_synth::advance(size_t n)
+{
+    for (TONE& t : d_tones)
+    {
+        t.phase = std::fmod(t.phase + t.inc * n, TWO_PI);
+        if (t.phase < 0)
+            t.phase += TWO_PI;
+    }
+}
+
+void tone_synth::synth(float* out, size_t n)
+{
+    std::fill_n(out, n, d_base);
+    for (const TONE& t : d_tones)
+    {
+        // 块起点的相量 z（含幅度）每块旋转一次，块内 Re(z e^{i j inc}) 各样点互不依赖
+        gr_complex z = std::polar(t.amp, (float) t.phase);
+        size_t i = 0;
+        for (; i + BLOCK <= n; i += BLOCK)
+        {
+            const float zr = z.real(), zi = z.imag();
+            for (int j = 0; j < BLOCK; j++)
+                out[i + j] += zr * t.lane_re[j] - zi * t.lane_im[j];
+            z *= t.step;
+        }
+        for (size_t j = 0; i + j < n; j++)
+            out[i + j] += z.real() * t.lane_re[j] - z.imag() * t.lane_im[j];
+    }
+    advance(n);
+}
+
+} // namespace reader
+} // namespace gr
@@ -0,0 +1,64 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2025 gr-reader author.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_READER_TONE_SYNTH_H
+#define INCLUDED_READER_TONE_SYNTH_H
+
+#include <gnuradio/gr_complex.h>
+#include <array>
+#include <vector>
+
+namespace gr {
+namespace reader {
+
+/*
+ * 多音载波合成（NCO）：输出 base + sum_k a_k cos(phi_k)，base = 1 - sum_k a_k，保证峰值不超过 1。
+ *
+ * 每路的相位以 double 累加、按经过的样点数推进，与是否正在输出多音 CW 无关，
+ * 因此相邻两段 CW 之间相位连续（相当于振荡器一直在跑），改频率时也不跳相。
+ * 合成按 BLOCK 个样点分块：块内用预先算好的 e^{i j dphi}（j < BLOCK）乘以块起点的相量，
+ * 各样点互不依赖，内层循环可以被编译器向量化；块起点的相量每块乘一次 e^{i BLOCK dphi}，
+ * 每次调用从 double 相位重新取起点，递推误差不跨调用累积。
+ */
+class tone_synth
+{
+public:
+    static constexpr int BLOCK = 64;
+
+    explicit tone_synth(double sample_rate);
+
+    // 设置各路频率（Hz）与幅度（线性）；保留已有路的相位，新增的路从 0 相位开始
+    void set_tones(const std::vector<float>& freqs, const std::vector<float>& amps);
+
+    int size() const { return (int) d_tones.size(); }
+
+    // 其他波形段输出了 n 个样点：只推进相位
+    void advance(size_t n);
+
+    // 输出 n 个样点的多音 CW 并推进相位
+    void synth(float* out, size_t n);
+
+private:
+    struct TONE
+    {
+        double phase;                         // 当前相位（rad，[0, 2pi)）
+        double inc;                           // 每样点相位增量（rad）
+        float amp;
+        std::array<float, BLOCK> lane_re;     // cos(j inc)，j = 0..BLOCK-1
+        std::array<float, BLOCK> lane_im;     // sin(j inc)
+        gr_complex step;                      // e^{i BLOCK inc}
+    };
+
+    double d_rate;
+    float d_base;
+    std::vector<TONE> d_tones;
+};
+
+} // namespace reader
+} // namespace gr
+
+#endif /* INCLUDED_READER_TONE_SYNTH_H */
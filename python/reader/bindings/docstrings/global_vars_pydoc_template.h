@@ -19,21 +19,12 @@
  static const char *__doc_gr_reader_READER_STATS = R"doc()doc";
 
 
- static const char *__doc_gr_reader_READER_STATS_READER_STATS_0 = R"doc()doc";
-
-
  static const char *__doc_gr_reader_READER_STATS_READER_STATS_1 = R"doc()doc";
 
  
  static const char *__doc_gr_reader_READER_STATE = R"doc()doc";
 
 
- static const char *__doc_gr_reader_READER_STATE_READER_STATE_0 = R"doc()doc";
-
-
- static const char *__doc_gr_reader_READER_STATE_READER_STATE_1 = R"doc()doc";
-
-
- static const char *__doc_gr_reader_initialize_reader_state = R"doc()doc";
+ static const char *__doc_gr_reader_READER_STATE_make = R"doc()doc";
 
   
@@ -30,4 +30,16 @@
 
  static const char *__doc_gr_reader_reader_print_results = R"doc()doc";
 
+
+ static const char *__doc_gr_reader_reader_set_link_profile = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_reader_link_profile = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_reader_set_tones = R"doc()doc";
+
   
+
+
+ static const char *__doc_gr_reader_reader_turnaround_latency = R"doc()doc";
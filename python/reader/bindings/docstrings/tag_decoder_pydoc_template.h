@@ -24,4 +24,10 @@
 
  static const char *__doc_gr_reader_tag_decoder_make = R"doc()doc";
 
+
+ static const char *__doc_gr_reader_tag_decoder_set_decoder_mode = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_decoder_decoder_mode = R"doc()doc";
+
   
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2025 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+#include "pydoc_macros.h"
+#define D(...) DOC(gr,reader, __VA_ARGS__ )
+/*
+  This file contains placeholders for docstrings for the Python bindings.
+  Do not edit! These were automatically extracted during the binding process
+  and will be overwritten during the build process
+ */
+
+
+ 
+ static const char *__doc_gr_reader_tag_emulator = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_emulator_tag_emulator = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_emulator_make = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_emulator_set_snr_db = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_emulator_n_replies = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_emulator_n_inventoried = R"doc()doc";
+
+  
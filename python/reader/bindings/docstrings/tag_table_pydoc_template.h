@@ -0,0 +1,42 @@
+/*
+ * Copyright 2025 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+#include "pydoc_macros.h"
+#define D(...) DOC(gr,reader, __VA_ARGS__ )
+/*
+  This file contains placeholders for docstrings for the Python bindings.
+  Do not edit! These were automatically extracted during the binding process
+  and will be overwritten during the build process
+ */
+
+
+ 
+ static const char *__doc_gr_reader_TAG_ENTRY = R"doc()doc";
+
+ 
+ static const char *__doc_gr_reader_tag_table = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_table_tag_table = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_table_reset = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_table_clear = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_table_size = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_table_capacity = R"doc()doc";
+
+
+ static const char *__doc_gr_reader_tag_table_n_dropped = R"doc()doc";
+
+  
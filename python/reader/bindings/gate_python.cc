@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(gate.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(399ab145579207a6133b08bc4a92e1fa)                     */
+/* BINDTOOL_HEADER_FILE_HASH(64297f9d1d9f1fea73ed800137d17328)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -37,7 +37,9 @@ void bind_gate(py::module& m)
         std::shared_ptr<gate>>(m, "gate", D(gate))
 
         .def(py::init(&gate::make),
+           py::arg("reader_state"),
            py::arg("sample_rate"),
+           py::arg("decimation") = 1,
            D(gate,make)
         )
         
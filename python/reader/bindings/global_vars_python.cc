@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(global_vars.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(0e26144cf6b54975753cdd1074e70aab)                     */
+/* BINDTOOL_HEADER_FILE_HASH(d1c2db89f335782079a74151ed1cca60)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -37,9 +37,6 @@ void bind_global_vars(py::module& m)
     py::class_<READER_STATS,
         std::shared_ptr<READER_STATS>>(m, "READER_STATS", D(READER_STATS))
 
-        .def(py::init<gr::reader::READER_STATS const &>(),           py::arg("arg0"),
-           D(READER_STATS,READER_STATS,0)
-        )
         .def(py::init<>(),D(READER_STATS,READER_STATS,1))
 
         ;
@@ -48,10 +45,10 @@ void bind_global_vars(py::module& m)
     py::class_<READER_STATE,
         std::shared_ptr<READER_STATE>>(m, "READER_STATE", D(READER_STATE))
 
-        .def(py::init<gr::reader::READER_STATE const &>(),           py::arg("arg0"),
-           D(READER_STATE,READER_STATE,0)
+        .def(py::init(&READER_STATE::make),
+           py::arg("max_tags") = ::gr::reader::TAG_TABLE_DEFAULT_SIZE,
+           D(READER_STATE,make)
         )
-        .def(py::init<>(),D(READER_STATE,READER_STATE,1))
 
         ;
 
@@ -96,10 +93,37 @@ void bind_global_vars(py::module& m)
 
     py::implicitly_convertible<int, ::gr::reader::DECODER_STATUS>();
 
+    py::enum_<::gr::reader::DECODER_MODE>(m,"DECODER_MODE")
+        .value("DECODER_MODE_HARD", ::gr::reader::DECODER_MODE_HARD) // 0
+        .value("DECODER_MODE_VITERBI", ::gr::reader::DECODER_MODE_VITERBI) // 1
+        .export_values()
+    ;
+
+    py::implicitly_convertible<int, ::gr::reader::DECODER_MODE>();
+
+    py::enum_<::gr::reader::ANTI_COLLISION>(m,"ANTI_COLLISION")
+        .value("AC_FIXED_Q", ::gr::reader::AC_FIXED_Q) // 0
+        .value("AC_Q_ALGORITHM", ::gr::reader::AC_Q_ALGORITHM) // 1
+        .value("AC_DFSA_SCHOUTE", ::gr::reader::AC_DFSA_SCHOUTE) // 2
+        .export_values()
+    ;
+
+    py::implicitly_convertible<int, ::gr::reader::ANTI_COLLISION>();
+
+    py::enum_<::gr::reader::LINK_PROFILE>(m,"LINK_PROFILE")
+        .value("LINK_BLF40_FM0", ::gr::reader::LINK_BLF40_FM0) // 0
+        .value("LINK_BLF160_FM0", ::gr::reader::LINK_BLF160_FM0) // 1
+        .value("LINK_BLF320_FM0", ::gr::reader::LINK_BLF320_FM0) // 2
+        .value("LINK_BLF640_FM0", ::gr::reader::LINK_BLF640_FM0) // 3
+        .value("LINK_BLF160_M2", ::gr::reader::LINK_BLF160_M2) // 4
+        .value("LINK_BLF256_M4", ::gr::reader::LINK_BLF256_M4) // 5
+        .value("LINK_BLF320_M8", ::gr::reader::LINK_BLF320_M8) // 6
+        .export_values()
+    ;
+
+    py::implicitly_convertible<int, ::gr::reader::LINK_PROFILE>();
+
 
-        m.def("initialize_reader_state",&::gr::reader::initialize_reader_state,
-            D(initialize_reader_state)
-        );
 
 
 
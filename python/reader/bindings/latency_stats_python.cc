@@ -0,0 +1,72 @@
+/*
+ * Copyright 2025 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(latency_stats.h)                                          */
+/* BINDTOOL_HEADER_FILE_HASH(5f9ee9494d252899cb19be435542412c)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/reader/latency_stats.h>
+// pydoc.h is automatically generated in the build directory
+#include <latency_stats_pydoc.h>
+
+void bind_latency_stats(py::module& m)
+{
+
+    using LATENCY_SUMMARY    = ::gr::reader::LATENCY_SUMMARY;
+
+
+    py::class_<LATENCY_SUMMARY,
+        std::shared_ptr<LATENCY_SUMMARY>>(m, "LATENCY_SUMMARY", D(LATENCY_SUMMARY))
+
+        .def_readonly("count", &LATENCY_SUMMARY::count)
+        .def_readonly("p50_us", &LATENCY_SUMMARY::p50_us)
+        .def_readonly("p99_us", &LATENCY_SUMMARY::p99_us)
+        .def_readonly("max_us", &LATENCY_SUMMARY::max_us)
+        ;
+
+
+    py::enum_<::gr::reader::TURNAROUND>(m,"TURNAROUND")
+        .value("TURNAROUND_RN16_ACK", ::gr::reader::TURNAROUND_RN16_ACK) // 0
+        .value("TURNAROUND_EPC_NEXT", ::gr::reader::TURNAROUND_EPC_NEXT) // 1
+        .export_values()
+    ;
+
+    py::implicitly_convertible<int, ::gr::reader::TURNAROUND>();
+
+    py::enum_<::gr::reader::LATENCY_STAGE>(m,"LATENCY_STAGE")
+        .value("LAT_GATE_TO_DECODER", ::gr::reader::LAT_GATE_TO_DECODER) // 0
+        .value("LAT_DECODER_TO_RENDER", ::gr::reader::LAT_DECODER_TO_RENDER) // 1
+        .value("LAT_RENDER_TO_EMIT", ::gr::reader::LAT_RENDER_TO_EMIT) // 2
+        .value("LAT_TOTAL", ::gr::reader::LAT_TOTAL) // 3
+        .value("LAT_AIR", ::gr::reader::LAT_AIR) // 4
+        .export_values()
+    ;
+
+    py::implicitly_convertible<int, ::gr::reader::LATENCY_STAGE>();
+
+
+    m.def("wall_clock_ns",&::gr::reader::wall_clock_ns,
+        D(wall_clock_ns)
+    );
+
+
+
+}
@@ -22,8 +22,11 @@ namespace py = pybind11;
 /**************************************/
 // BINDING_FUNCTION_PROTOTYPES(
     void bind_global_vars(py::module& m);
+    void bind_tag_table(py::module& m);
+    void bind_latency_stats(py::module& m);
     void bind_gate(py::module& m);
     void bind_tag_decoder(py::module& m);
+    void bind_tag_emulator(py::module& m);
     void bind_reader(py::module& m);
 // ) END BINDING_FUNCTION_PROTOTYPES
 
@@ -53,9 +56,12 @@ PYBIND11_MODULE(reader_python, m)
     // Please do not delete
     /**************************************/
     // BINDING_FUNCTION_CALLS(
+    bind_tag_table(m);
+    bind_latency_stats(m);
     bind_global_vars(m);
     bind_gate(m);
     bind_tag_decoder(m);
+    bind_tag_emulator(m);
     bind_reader(m);
     // ) END BINDING_FUNCTION_CALLS
 }
\ No newline at end of file
@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(reader.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(403b7503ed867632f7e9c26712052b95)                     */
+/* BINDTOOL_HEADER_FILE_HASH(35567e55458868eed47cda1d1a3686ff)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -37,11 +37,13 @@ void bind_reader(py::module& m)
         std::shared_ptr<reader>>(m, "reader", D(reader))
 
         .def(py::init(&reader::make),
+           py::arg("reader_state"),
            py::arg("sample_rate"),
            py::arg("dac_rate"),
            py::arg("num_sines"),
            py::arg("freqs"),
            py::arg("amps"),
+           py::arg("link_profile") = ::gr::reader::LINK_BLF40_FM0,
            D(reader,make)
         )
         
@@ -54,6 +56,31 @@ void bind_reader(py::module& m)
             D(reader,print_results)
         )
 
+
+        .def("set_link_profile",&reader::set_link_profile,
+            py::arg("link_profile"),
+            D(reader,set_link_profile)
+        )
+
+
+        .def("link_profile",&reader::link_profile,
+            D(reader,link_profile)
+        )
+
+
+        .def("set_tones",&reader::set_tones,
+            py::arg("freqs"),
+            py::arg("amps"),
+            D(reader,set_tones)
+        )
+
+
+        .def("turnaround_latency",&reader::turnaround_latency,
+            py::arg("path"),
+            py::arg("stage"),
+            D(reader,turnaround_latency)
+        )
+
         ;
 
 
@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(tag_decoder.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(b07060e77c8c21965e6d8847c0cc8865)                     */
+/* BINDTOOL_HEADER_FILE_HASH(1b6cee55cc8b39858fb778a7abb78f76)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -37,11 +37,26 @@ void bind_tag_decoder(py::module& m)
         std::shared_ptr<tag_decoder>>(m, "tag_decoder", D(tag_decoder))
 
         .def(py::init(&tag_decoder::make),
+           py::arg("reader_state"),
            py::arg("sample_rate"),
+           py::arg("decoder_mode") = ::gr::reader::DECODER_MODE_HARD,
+           py::arg("anti_collision_policy") = ::gr::reader::AC_Q_ALGORITHM,
+           py::arg("initial_q") = ::gr::reader::INITIAL_Q,
            D(tag_decoder,make)
         )
         
 
+        .def("set_decoder_mode",&tag_decoder::set_decoder_mode,
+            py::arg("decoder_mode"),
+            D(tag_decoder,set_decoder_mode)
+        )
+
+
+        .def("decoder_mode",&tag_decoder::decoder_mode,
+            D(tag_decoder,decoder_mode)
+        )
+
+
 
 
         ;
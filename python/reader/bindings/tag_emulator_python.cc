@@ -0,0 +1,81 @@
+/*
+ * Copyright 2025 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(tag_emulator.h)                                  */
+/* BINDTOOL_HEADER_FILE_HASH(48bea8d1f82ed1382a581e7c1e34bb07)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/reader/tag_emulator.h>
+// pydoc.h is automatically generated in the build directory
+#include <tag_emulator_pydoc.h>
+
+void bind_tag_emulator(py::module& m)
+{
+
+    using tag_emulator    = ::gr::reader::tag_emulator;
+
+
+    py::class_<tag_emulator, gr::sync_block, gr::block, gr::basic_block,
+        std::shared_ptr<tag_emulator>>(m, "tag_emulator", D(tag_emulator))
+
+        .def(py::init(&tag_emulator::make),
+           py::arg("sample_rate"),
+           py::arg("n_tags") = 1,
+           py::arg("blf_error") = 0,
+           py::arg("snr_db") = 20,
+           py::arg("amplitude") = 0.05,
+           py::arg("phase") = 0,
+           py::arg("dc_offset") = gr_complex(0.6, 0.2),
+           py::arg("t1_jitter_us") = 0,
+           py::arg("seed") = 0,
+           D(tag_emulator,make)
+        )
+        
+
+        .def("set_snr_db",&tag_emulator::set_snr_db,
+            py::arg("snr_db"),
+            D(tag_emulator,set_snr_db)
+        )
+
+
+        .def("n_replies",&tag_emulator::n_replies,
+            D(tag_emulator,n_replies)
+        )
+
+
+        .def("n_inventoried",&tag_emulator::n_inventoried,
+            D(tag_emulator,n_inventoried)
+        )
+
+        ;
+
+
+
+
+}
+
+
+
+
+
+
+
+
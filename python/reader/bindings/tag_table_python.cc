@@ -0,0 +1,85 @@
+/*
+ * Copyright 2025 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(tag_table.h)                                          */
+/* BINDTOOL_HEADER_FILE_HASH(c12b7d51facf88cd9f3f41093714608f)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/reader/tag_table.h>
+// pydoc.h is automatically generated in the build directory
+#include <tag_table_pydoc.h>
+
+void bind_tag_table(py::module& m)
+{
+
+    using TAG_ENTRY    = ::gr::reader::TAG_ENTRY;
+    using tag_table    = ::gr::reader::tag_table;
+
+
+    py::class_<TAG_ENTRY,
+        std::shared_ptr<TAG_ENTRY>>(m, "TAG_ENTRY", D(TAG_ENTRY))
+
+        .def_readonly("epc", &TAG_ENTRY::epc)
+        .def_readonly("n_reads", &TAG_ENTRY::n_reads)
+        .def_readonly("last_rssi", &TAG_ENTRY::last_rssi)
+        ;
+
+
+    py::class_<tag_table,
+        std::shared_ptr<tag_table>>(m, "tag_table", D(tag_table))
+
+        .def(py::init<size_t>(),
+           py::arg("max_tags") = ::gr::reader::TAG_TABLE_DEFAULT_SIZE,
+           D(tag_table,tag_table)
+        )
+
+
+        .def("reset",&tag_table::reset,
+            py::arg("max_tags"),
+            D(tag_table,reset)
+        )
+
+
+        .def("clear",&tag_table::clear,
+            D(tag_table,clear)
+        )
+
+
+        .def("size",&tag_table::size,
+            D(tag_table,size)
+        )
+
+
+        .def("capacity",&tag_table::capacity,
+            D(tag_table,capacity)
+        )
+
+
+        .def("n_dropped",&tag_table::n_dropped,
+            D(tag_table,n_dropped)
+        )
+
+        ;
+
+
+
+
+}